@@ -0,0 +1,149 @@
+#include "AllocationTracker.hpp"
+
+#if UIEDITOR_ALLOCATION_TRACKING
+
+#include <algorithm>
+#include <cstdlib>
+#include <mutex>
+#include <new>
+
+// Nothing in this file may allocate from the heap: everything is called from within global operator new.
+
+namespace
+{
+    const unsigned MAX_SCOPE_DEPTH = 32;
+    const char* UNSCOPED = "(unscoped)";
+
+    thread_local const char* scope_stack[MAX_SCOPE_DEPTH];
+    thread_local unsigned scope_depth = 0;
+
+    std::mutex sites_mutex;
+    AllocationSite current_sites[AllocationTracker::MAX_SITES];
+    unsigned current_sites_count = 0;
+    AllocationSite frame_sites[AllocationTracker::MAX_SITES];
+    unsigned frame_sites_count = 0;
+
+    template<typename T>
+    T Min(T a, T b)
+    {
+        return a < b ? a : b;
+    }
+
+    void RecordAllocation(std::size_t size)
+    {
+        const char* name = scope_depth > 0 ? scope_stack[Min(scope_depth, MAX_SCOPE_DEPTH) - 1] : UNSCOPED;
+
+        std::lock_guard<std::mutex> lock(sites_mutex);
+        AllocationSite* site = nullptr;
+        for (unsigned i = 0; i < current_sites_count && site == nullptr; i++)
+        {
+            if (current_sites[i].name == name)
+                site = &current_sites[i];
+        }
+
+        if (site == nullptr)
+        {
+            // Once table is full further scopes are folded into the last entry.
+            if (current_sites_count < AllocationTracker::MAX_SITES)
+            {
+                site = &current_sites[current_sites_count++];
+                site->name = name;
+                site->count = 0;
+                site->bytes = 0;
+            }
+            else
+                site = &current_sites[AllocationTracker::MAX_SITES - 1];
+        }
+
+        site->count++;
+        site->bytes += size;
+    }
+
+    void* Allocate(std::size_t size)
+    {
+        RecordAllocation(size);
+        return std::malloc(size > 0 ? size : 1);
+    }
+}
+
+namespace AllocationTracker
+{
+    void PushScope(const char* name)
+    {
+        // Scopes nested deeper than the stack are attributed to the deepest scope that fits.
+        if (scope_depth < MAX_SCOPE_DEPTH)
+            scope_stack[scope_depth] = name;
+        scope_depth++;
+    }
+
+    void PopScope()
+    {
+        if (scope_depth > 0)
+            scope_depth--;
+    }
+
+    void EndFrame()
+    {
+        std::lock_guard<std::mutex> lock(sites_mutex);
+        std::copy(current_sites, current_sites + current_sites_count, frame_sites);
+        frame_sites_count = current_sites_count;
+        current_sites_count = 0;
+        std::sort(frame_sites, frame_sites + frame_sites_count, [](const AllocationSite& a, const AllocationSite& b) {
+            return a.count > b.count;
+        });
+    }
+
+    unsigned GetFrameSites(AllocationSite* sites, unsigned max_sites)
+    {
+        std::lock_guard<std::mutex> lock(sites_mutex);
+        auto count = Min(max_sites, frame_sites_count);
+        std::copy(frame_sites, frame_sites + count, sites);
+        return count;
+    }
+}
+
+void* operator new(std::size_t size)
+{
+    if (void* ptr = Allocate(size))
+        return ptr;
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size)
+{
+    if (void* ptr = Allocate(size))
+        return ptr;
+    throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+    return Allocate(size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+    return Allocate(size);
+}
+
+void operator delete(void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, const std::nothrow_t&) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept
+{
+    std::free(ptr);
+}
+
+#endif
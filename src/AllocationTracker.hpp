@@ -0,0 +1,45 @@
+#pragma once
+
+
+#include <cstddef>
+
+/// Heap allocation statistics of a named scope.
+struct AllocationSite
+{
+    const char* name;
+    unsigned count;
+    unsigned long long bytes;
+};
+
+#if UIEDITOR_ALLOCATION_TRACKING
+
+/// Counts global operator new calls per frame, attributed to innermost named scope of allocating thread. Enabled by
+/// UIEDITOR_ALLOCATION_TRACKING build option, see AllocationTracker.cpp.
+namespace AllocationTracker
+{
+    /// Maximum number of distinct scopes tracked during one frame.
+    static const unsigned MAX_SITES = 64;
+
+    /// Make `name` innermost scope of calling thread. `name` must be a string literal.
+    void PushScope(const char* name);
+    void PopScope();
+    /// Store statistics of ending frame and start counting a new one.
+    void EndFrame();
+    /// Copy statistics of last complete frame sorted by allocation count. Return number of sites copied.
+    unsigned GetFrameSites(AllocationSite* sites, unsigned max_sites);
+}
+
+#endif
+
+/// Attributes heap allocations made in enclosing block to `name`. Compiles to nothing unless allocation tracking is
+/// enabled.
+class AllocationScope
+{
+public:
+#if UIEDITOR_ALLOCATION_TRACKING
+    explicit AllocationScope(const char* name) { AllocationTracker::PushScope(name); }
+    ~AllocationScope() { AllocationTracker::PopScope(); }
+#else
+    explicit AllocationScope(const char*) { }
+#endif
+};
@@ -0,0 +1,180 @@
+#pragma once
+
+
+#include <Atomic/Container/Str.h>
+
+#include <cstdio>
+#include <cstring>
+
+#if !defined(_WIN32)
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+using namespace Atomic;
+
+
+/// Line based request channel of server mode. Requests are read from stdin and responses written to stdout, or both
+/// go through clients of a UNIX domain socket, one client at a time.
+class CommandChannel
+{
+public:
+    CommandChannel() = default;
+    CommandChannel(const CommandChannel&) = delete;
+    CommandChannel& operator=(const CommandChannel&) = delete;
+    ~CommandChannel() { Close(); }
+
+    /// Listen on UNIX domain socket at `socket_path` instead of using stdin and stdout. Fails when a file that is not a
+    /// socket exists at `socket_path`. Not available on Windows.
+    bool Listen(const String& socket_path)
+    {
+#if defined(_WIN32)
+        return false;
+#else
+        sockaddr_un address;
+        memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        if (socket_path.Length() >= sizeof(address.sun_path))
+            return false;
+        strcpy(address.sun_path, socket_path.CString());
+
+        // Socket left by a server that did not exit cleanly. Any other file is left alone.
+        struct stat info;
+        if (lstat(socket_path.CString(), &info) == 0)
+        {
+            if (!S_ISSOCK(info.st_mode))
+                return false;
+            unlink(socket_path.CString());
+        }
+        _listener = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (_listener < 0 || bind(_listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+            listen(_listener, 4) != 0)
+        {
+            Close();
+            return false;
+        }
+        _socket_path = socket_path;
+        return true;
+#endif
+    }
+
+    /// Block until next line arrives. Return false when stdin is closed or socket fails.
+    bool ReadLine(String& line)
+    {
+        for (;;)
+        {
+            auto newline = _buffer.Find('\n');
+            if (newline != String::NPOS)
+            {
+                line = _buffer.Substring(0, newline);
+                _buffer = _buffer.Substring(newline + 1);
+                if (line.EndsWith("\r"))
+                    line.Resize(line.Length() - 1);
+                return true;
+            }
+
+            if (!Fill())
+            {
+                // Last line of stdin may miss line terminator.
+                line = _buffer;
+                _buffer.Clear();
+                return !line.Empty();
+            }
+        }
+    }
+
+    /// Write line to stdout or current socket client.
+    void WriteLine(const String& line)
+    {
+#if !defined(_WIN32)
+        if (_listener >= 0)
+        {
+            auto text = line + "\n";
+            unsigned sent = 0;
+            while (_client >= 0 && sent < text.Length())
+            {
+                auto size = send(_client, text.CString() + sent, text.Length() - sent, SEND_FLAGS);
+                if (size <= 0)
+                {
+                    CloseClient();
+                    break;
+                }
+                sent += static_cast<unsigned>(size);
+            }
+            return;
+        }
+#endif
+        fwrite(line.CString(), 1, line.Length(), stdout);
+        fputc('\n', stdout);
+        fflush(stdout);
+    }
+
+    void Close()
+    {
+#if !defined(_WIN32)
+        CloseClient();
+        if (_listener >= 0)
+            close(_listener);
+        _listener = -1;
+        if (!_socket_path.Empty())
+            unlink(_socket_path.CString());
+        _socket_path.Clear();
+#endif
+    }
+
+protected:
+    /// Append more input to buffer.
+    bool Fill()
+    {
+        char buffer[4096];
+#if !defined(_WIN32)
+        if (_listener >= 0)
+        {
+            for (;;)
+            {
+                if (_client < 0)
+                {
+                    _client = accept(_listener, nullptr, nullptr);
+                    if (_client < 0)
+                        return false;
+                }
+
+                auto size = recv(_client, buffer, sizeof(buffer), 0);
+                if (size > 0)
+                {
+                    _buffer.Append(buffer, static_cast<unsigned>(size));
+                    return true;
+                }
+                // Client disconnected, incomplete request is dropped.
+                CloseClient();
+                _buffer.Clear();
+            }
+        }
+#endif
+        if (fgets(buffer, sizeof(buffer), stdin) == nullptr)
+            return false;
+        _buffer.Append(buffer);
+        return true;
+    }
+
+#if !defined(_WIN32)
+    void CloseClient()
+    {
+        if (_client >= 0)
+            close(_client);
+        _client = -1;
+    }
+
+#if defined(MSG_NOSIGNAL)
+    static const int SEND_FLAGS = MSG_NOSIGNAL;
+#else
+    static const int SEND_FLAGS = 0;
+#endif
+    int _listener = -1;
+    int _client = -1;
+#endif
+    String _socket_path;
+    String _buffer;
+};
@@ -0,0 +1,131 @@
+#pragma once
+
+
+#include <Atomic/Container/HashMap.h>
+#include <Atomic/Container/Str.h>
+#include <Atomic/Container/Vector.h>
+#include <Atomic/UI/SystemUI/SystemUI.h>
+
+#include <cstring>
+
+using namespace Atomic;
+namespace ui=ImGui;
+
+
+/// Pool of growable text buffers edited by InputText widgets. Buffers are identified by a key made of attribute index
+/// and item index. Released buffers keep their memory and are handed out again when next element is selected.
+class EditBuffers
+{
+public:
+    /// Minimal free space available to InputText on imgui versions that can not resize buffers while editing.
+    static const unsigned MIN_HEADROOM = 1024;
+    /// Reused buffers with capacity above this value shrink when they receive much shorter text.
+    static const unsigned SHRINK_THRESHOLD = 4096;
+
+    static unsigned MakeKey(unsigned attribute_index, unsigned item_index = 0)
+    {
+        return (attribute_index << 16) | (item_index & 0xFFFF);
+    }
+
+    /// Return buffer identified by `key`, filling it with `initial_text` when buffer is not in use yet.
+    PODVector<char>& Acquire(unsigned key, const String& initial_text)
+    {
+        auto it = _slots.Find(key);
+        if (it != _slots.End())
+            return _pool[it->second_];
+
+        unsigned slot;
+        if (!_free.Empty())
+        {
+            slot = _free.Back();
+            _free.Pop();
+        }
+        else
+        {
+            slot = _pool.Size();
+            _pool.Resize(slot + 1);
+        }
+        _slots[key] = slot;
+
+        auto& buffer = _pool[slot];
+        auto size = initial_text.Length() + 1;
+        if (buffer.Capacity() > Max(size * 4, SHRINK_THRESHOLD))
+        {
+            buffer.Clear();
+            buffer.Compact();
+        }
+        buffer.Resize(size);
+        memcpy(&buffer.Front(), initial_text.CString(), size);
+        return buffer;
+    }
+
+    /// Render text input editing buffer `key`. Text length is not limited by buffer size.
+    bool InputText(const char* label, unsigned key, const String& initial_text, ImGuiInputTextFlags flags = 0)
+    {
+        auto& buffer = Acquire(key, initial_text);
+#if defined(IMGUI_VERSION_NUM) && IMGUI_VERSION_NUM >= 16300
+        return ui::InputText(label, &buffer.Front(), buffer.Size(), flags | ImGuiInputTextFlags_CallbackResize,
+                             &EditBuffers::OnResize, &buffer);
+#else
+        // Older imgui sizes its edit state when widget is activated, so keep enough free space for typing and
+        // pasting. Buffer keeps growing between frames as text gets longer.
+        auto length = static_cast<unsigned>(strlen(&buffer.Front()));
+        if (buffer.Size() < length + MIN_HEADROOM + 1)
+            buffer.Resize(length * 2 + MIN_HEADROOM + 1);
+        return ui::InputText(label, &buffer.Front(), buffer.Size(), flags);
+#endif
+    }
+
+    const char* GetText(unsigned key) const
+    {
+        auto it = _slots.Find(key);
+        if (it == _slots.End())
+            return "";
+        return &_pool[it->second_].Front();
+    }
+
+    void ClearText(unsigned key)
+    {
+        auto it = _slots.Find(key);
+        if (it != _slots.End())
+            _pool[it->second_].Front() = 0;
+    }
+
+    /// Return all buffers to the pool. Their contents are refreshed from attribute values on next use.
+    void ReleaseAll()
+    {
+        for (auto it: _slots)
+            _free.Push(it.second_);
+        _slots.Clear();
+    }
+
+    /// Return number of bytes reserved by all pooled buffers.
+    unsigned GetMemoryUse() const
+    {
+        unsigned total = 0;
+        for (const auto& buffer: _pool)
+            total += buffer.Capacity();
+        return total;
+    }
+
+protected:
+#if defined(IMGUI_VERSION_NUM) && IMGUI_VERSION_NUM >= 16300
+    static int OnResize(ImGuiInputTextCallbackData* data)
+    {
+        if (data->EventFlag == ImGuiInputTextFlags_CallbackResize)
+        {
+            auto buffer = static_cast<PODVector<char>*>(data->UserData);
+            buffer->Resize(static_cast<unsigned>(data->BufSize));
+            data->Buf = &buffer->Front();
+        }
+        return 0;
+    }
+#endif
+
+    /// Buffer storage, never shrinks so buffers can be reused.
+    Vector<PODVector<char>> _pool;
+    /// Map of buffer key to index in `_pool`.
+    HashMap<unsigned, unsigned> _slots;
+    /// Indices of `_pool` buffers that are not in use.
+    PODVector<unsigned> _free;
+};
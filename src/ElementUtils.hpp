@@ -0,0 +1,182 @@
+#pragma once
+
+
+#include <Atomic/Container/Str.h>
+#include <Atomic/Core/Attribute.h>
+#include <Atomic/Resource/XMLElement.h>
+
+#include <UrhoUI.h>
+
+using namespace Atomic;
+using namespace Atomic::UrhoUI;
+
+
+/// Attribute of style element that was modified, with its value before the change. Empty value means attribute was
+/// not set in style.
+struct StyleAttributeChange
+{
+    XMLElement style;
+    String name;
+    Variant old_value;
+};
+
+/// Limit of base style chain length, guards against cycles in broken style files.
+static const unsigned MAX_STYLE_DEPTH = 32;
+
+/// Element types that can be created from the editor, null terminated.
+static const char* UI_ELEMENT_TYPES[] = {"BorderImage", "Button", "CheckBox", "Cursor", "DropDownList", "LineEdit",
+    "ListView", "Menu", "ProgressBar", "ScrollBar", "ScrollView", "Slider", "Sprite", "Text", "ToolTip", "UIElement",
+    "View3D", "Window", 0
+};
+
+/// Return index of `child` in children list of its parent or -1.
+inline int GetChildIndex(UIElement* child)
+{
+    auto parent = child->GetParent();
+    if (parent == nullptr)
+        return -1;
+
+    const auto& children = parent->GetChildren();
+    for (auto i = 0; i < children.Size(); i++)
+    {
+        if (children[i] == child)
+            return i;
+    }
+    return -1;
+}
+
+/// Return human readable path of `element` relative to `root`, made of element names (or types when name is empty)
+/// and child indices, for example "Window[0]/Button[3]".
+inline String GetElementPath(UIElement* element, UIElement* root = nullptr)
+{
+    String path;
+    for (; element != nullptr && element != root; element = element->GetParent())
+    {
+        const auto& name = element->GetName();
+        auto part = ToString("%s[%d]", name.Empty() ? element->GetTypeName().CString() : name.CString(),
+                             GetChildIndex(element));
+        path = path.Empty() ? part : part + "/" + path;
+    }
+    return path;
+}
+
+/// Return element at `path` made by GetElementPath() relative to `root`, or null when layout has no such element.
+/// Only child indices are followed, names are not compared.
+inline UIElement* FindElementByPath(UIElement* root, const String& path)
+{
+    auto element = root;
+    for (const auto& part: path.Split('/'))
+    {
+        auto open = part.FindLast('[');
+        if (element == nullptr || open == String::NPOS)
+            return nullptr;
+        auto index = ToUInt(part.Substring(open + 1));
+        element = index < element->GetNumChildren() ? element->GetChild(index) : nullptr;
+    }
+    return element;
+}
+
+/// Return description of attribute `name` of `item`, or null when item has no such attribute.
+inline const AttributeInfo* FindAttributeInfo(const Serializable* item, const String& name)
+{
+    auto attributes = item->GetAttributes();
+    if (attributes == nullptr)
+        return nullptr;
+    for (const auto& info: *attributes)
+    {
+        if (info.name_ == name)
+            return &info;
+    }
+    return nullptr;
+}
+
+/// Return `<attribute>` child of style element with given name.
+inline XMLElement GetStyleAttribute(const XMLElement& style, const String& name)
+{
+    for (auto attribute = style.GetChild("attribute"); attribute.NotNull(); attribute = attribute.GetNext("attribute"))
+    {
+        if (attribute.GetAttribute("name") == name)
+            return attribute;
+    }
+    return XMLElement();
+}
+
+/// Set value of style attribute, creating `<attribute>` element if needed. Return true if style was modified.
+inline bool SetStyleAttribute(XMLElement style, const String& name, const String& value)
+{
+    auto attribute = GetStyleAttribute(style, name);
+    if (attribute.IsNull())
+    {
+        attribute = style.CreateChild("attribute");
+        attribute.SetAttribute("name", name);
+    }
+    else if (attribute.GetAttribute("value") == value)
+        return false;
+    attribute.SetAttribute("value", value);
+    return true;
+}
+
+/// Return top level style element of given type.
+inline XMLElement FindStyle(const XMLElement& root, const String& type)
+{
+    for (auto style = root.GetChild("element"); style.NotNull(); style = style.GetNext("element"))
+    {
+        if (style.GetAttribute("type") == type)
+            return style;
+    }
+    return XMLElement();
+}
+
+/// Return name of top level style that contains `style`, which may be a nested style of an internal element.
+inline String GetStyleName(XMLElement style)
+{
+    while (style.GetParent().NotNull() && style.GetParent().GetName() == "element")
+        style = style.GetParent();
+    return style.GetAttribute("type");
+}
+
+/// Return `<attribute>` with given name from style element or its base styles.
+inline XMLElement FindStyleAttribute(const XMLElement& root, XMLElement style, const String& name)
+{
+    for (unsigned depth = 0; style.NotNull() && depth < MAX_STYLE_DEPTH; depth++)
+    {
+        auto attribute = GetStyleAttribute(style, name);
+        if (attribute.NotNull())
+            return attribute;
+
+        auto base_style = style.GetAttribute("style");
+        style = base_style.Empty() ? XMLElement() : FindStyle(root, base_style);
+    }
+    return XMLElement();
+}
+
+/// Read value of `<attribute>` element as a value of attribute described by `info`. Enum names are converted to
+/// indices, unknown names are returned as strings.
+inline Variant GetAttributeValue(const XMLElement& attribute, const AttributeInfo& info)
+{
+    Variant value = attribute.GetVariantValue(info.enumNames_ ? VAR_STRING : info.type_);
+    if (info.enumNames_)
+    {
+        for (auto i = 0; info.enumNames_[i]; i++)
+        {
+            if (value.GetString() == info.enumNames_[i])
+                return i;
+        }
+    }
+    return value;
+}
+
+/// Convert style attribute string to a value of attribute described by `info`, like GetAttributeValue().
+inline Variant GetAttributeValue(const String& value, const AttributeInfo& info)
+{
+    if (info.enumNames_)
+    {
+        for (auto i = 0; info.enumNames_[i]; i++)
+        {
+            if (value == info.enumNames_[i])
+                return i;
+        }
+        return value;
+    }
+    return Variant(info.type_, value);
+}
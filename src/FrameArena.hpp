@@ -0,0 +1,160 @@
+#pragma once
+
+
+#include <Atomic/Container/Vector.h>
+
+#include <cctype>
+#include <cstdarg>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+using namespace Atomic;
+
+
+/// Bump allocator for transient data that lives until the end of current frame. All allocations are released at once
+/// by Reset(). Objects allocated from arena are never destructed, therefore only trivially destructible data belongs
+/// here.
+class FrameArena
+{
+public:
+    static const unsigned DEFAULT_BLOCK_SIZE = 64 * 1024;
+
+    explicit FrameArena(unsigned block_size = DEFAULT_BLOCK_SIZE)
+        : _block_size(block_size)
+    {
+    }
+
+    FrameArena(const FrameArena&) = delete;
+    FrameArena& operator=(const FrameArena&) = delete;
+
+    ~FrameArena()
+    {
+        for (auto& block: _blocks)
+            std::free(block.data);
+    }
+
+    /// Allocate `size` bytes aligned to `alignment`, which must be a power of two.
+    void* Allocate(unsigned size, unsigned alignment = alignof(std::max_align_t))
+    {
+        while (_current < _blocks.Size())
+        {
+            auto& block = _blocks[_current];
+            auto offset = (block.used + alignment - 1) & ~(alignment - 1);
+            if (offset + size <= block.size)
+            {
+                block.used = offset + size;
+                _allocated += size;
+                return block.data + offset;
+            }
+            _current++;
+        }
+
+        Block block;
+        block.size = Max(_block_size, size + alignment);
+        block.data = static_cast<unsigned char*>(std::malloc(block.size));
+        block.used = 0;
+        _blocks.Push(block);
+        _current = _blocks.Size() - 1;
+        return Allocate(size, alignment);
+    }
+
+    /// Release all allocations. When previous frame did not fit into one block, blocks are merged into a single
+    /// bigger one so steady state frames never call malloc.
+    void Reset()
+    {
+        if (_blocks.Size() > 1 && _current > 0)
+        {
+            unsigned total_size = 0;
+            for (auto& block: _blocks)
+            {
+                total_size += block.size;
+                std::free(block.data);
+            }
+            _blocks.Clear();
+            _block_size = Max(_block_size, total_size);
+        }
+
+        for (auto& block: _blocks)
+            block.used = 0;
+        _current = 0;
+        _peak = Max(_peak, _allocated);
+        _allocated = 0;
+    }
+
+    /// Format a null-terminated string that is valid until next Reset().
+    const char* Format(const char* format, ...)
+    {
+        va_list args;
+        va_start(args, format);
+        auto result = FormatV(format, args);
+        va_end(args);
+        return result;
+    }
+
+    const char* FormatV(const char* format, va_list args)
+    {
+        va_list args_copy;
+        va_copy(args_copy, args);
+        auto length = vsnprintf(nullptr, 0, format, args_copy);
+        va_end(args_copy);
+        if (length < 0)
+            return "";
+
+        auto buffer = static_cast<char*>(Allocate(static_cast<unsigned>(length) + 1, 1));
+        vsnprintf(buffer, static_cast<size_t>(length) + 1, format, args);
+        return buffer;
+    }
+
+    /// Return lowercase copy of `text` that is valid until next Reset().
+    const char* ToLower(const char* text)
+    {
+        auto length = static_cast<unsigned>(strlen(text));
+        auto buffer = static_cast<char*>(Allocate(length + 1, 1));
+        for (unsigned i = 0; i < length; i++)
+            buffer[i] = static_cast<char>(tolower(static_cast<unsigned char>(text[i])));
+        buffer[length] = 0;
+        return buffer;
+    }
+
+    /// Return number of bytes allocated since last Reset().
+    unsigned GetAllocated() const { return _allocated; }
+    /// Return highest number of bytes allocated in one frame.
+    unsigned GetPeak() const { return Max(_peak, _allocated); }
+
+protected:
+    struct Block
+    {
+        unsigned char* data;
+        unsigned size;
+        unsigned used;
+    };
+
+    PODVector<Block> _blocks;
+    unsigned _current = 0;
+    unsigned _block_size;
+    unsigned _allocated = 0;
+    unsigned _peak = 0;
+};
+
+/// Case-insensitive substring search that does not allocate. `lower_needle` must already be lowercase.
+inline bool ContainsNoCase(const char* haystack, const char* lower_needle)
+{
+    if (*lower_needle == 0)
+        return true;
+
+    for (; *haystack; haystack++)
+    {
+        auto h = haystack;
+        auto n = lower_needle;
+        while (*h && *n && tolower(static_cast<unsigned char>(*h)) == static_cast<unsigned char>(*n))
+        {
+            h++;
+            n++;
+        }
+        if (*n == 0)
+            return true;
+    }
+    return false;
+}
@@ -0,0 +1,280 @@
+#pragma once
+
+
+#include <Atomic/Core/Object.h>
+#include <Atomic/Core/CoreEvents.h>
+#include <Atomic/UI/SystemUI/SystemUI.h>
+
+#include <chrono>
+#include <cstdio>
+
+#include "AllocationTracker.hpp"
+#include "TraceRecorder.hpp"
+
+using namespace Atomic;
+namespace ui=ImGui;
+
+
+/// Collects per-frame timings of editor phases and per-frame event counters. Timings are gathered only while profiler
+/// is enabled, which happens when overlay is visible, or while a trace is being recorded.
+class FrameProfiler : public Object
+{
+    ATOMIC_OBJECT(FrameProfiler, Object);
+public:
+    enum Phase
+    {
+        PHASE_FRAME,
+        PHASE_UPDATE,
+        PHASE_UI_RENDER,
+        PHASE_DEBUG_RENDER,
+        PHASE_UI_TREE,
+        PHASE_ATTRIBUTES,
+        PHASE_STYLE_DATA,
+        PHASE_COUNT
+    };
+
+    enum Counter
+    {
+        COUNTER_XPATH_QUERIES,
+        COUNTER_APPLY_ATTRIBUTES,
+        COUNTER_UNDO_PUSHES,
+        COUNTER_RESTYLES,
+        COUNTER_COUNT
+    };
+
+    /// Values sampled once per frame and shown as they are, like memory use of editor data.
+    enum Gauge
+    {
+        GAUGE_EDIT_BUFFER_BYTES,
+        GAUGE_STYLE_INDEXED_ELEMENTS,
+        GAUGE_COUNT
+    };
+
+    typedef TraceRecorder::Clock Clock;
+
+    /// Number of frames kept in history.
+    static const unsigned HISTORY_SIZE = 180;
+
+    FrameProfiler(Context* ctx) : Object(ctx)
+    {
+        SubscribeToEvent(E_BEGINFRAME, std::bind(&FrameProfiler::OnBeginFrame, this));
+    }
+
+    bool IsEnabled() const { return _enabled; }
+
+    /// Return true when phase timings are needed either by overlay or by trace recorder.
+    bool IsActive() const { return _enabled || (_trace.NotNull() && _trace->IsRecording()); }
+
+    void SetTraceRecorder(TraceRecorder* trace) { _trace = trace; }
+
+    void SetEnabled(bool enabled)
+    {
+        if (enabled && !_enabled)
+            Reset();
+        _enabled = enabled;
+    }
+
+    /// Add time to a phase of current frame.
+    void AddTime(Phase phase, Clock::time_point start, Clock::time_point end)
+    {
+        if (_enabled)
+            _current_time[phase] += end - start;
+        if (_trace.NotNull())
+            _trace->AddZone(GetPhaseName(phase), "phase", start, end);
+    }
+
+    /// Increment event counter of current frame.
+    void Count(Counter counter, unsigned amount = 1)
+    {
+        if (_enabled)
+            _current_count[counter] += amount;
+    }
+
+    /// Set value of a gauge shown by overlay.
+    void SetGauge(Gauge gauge, unsigned value)
+    {
+        if (_enabled)
+            _gauges[gauge] = value;
+    }
+
+    void Reset()
+    {
+        for (auto i = 0; i < PHASE_COUNT; i++)
+            _current_time[i] = Clock::duration::zero();
+        for (auto i = 0; i < COUNTER_COUNT; i++)
+            _current_count[i] = 0;
+        _history_head = 0;
+        _history_size = 0;
+        _frame_start = Clock::now();
+    }
+
+    void RenderOverlay(bool* open)
+    {
+        ui::SetNextWindowSize({460.f, 0.f}, ImGuiSetCond_Once);
+        if (ui::Begin("Frame Profiler", open))
+        {
+            ui::Text("Frames sampled: %u", _history_size);
+            ui::Separator();
+            for (auto i = 0; i < PHASE_COUNT; i++)
+                RenderHistory(GetPhaseName(static_cast<Phase>(i)), _time_history[i], "ms");
+            ui::Separator();
+            for (auto i = 0; i < COUNTER_COUNT; i++)
+                RenderHistory(GetCounterName(static_cast<Counter>(i)), _count_history[i], "");
+            ui::Separator();
+            for (auto i = 0; i < GAUGE_COUNT; i++)
+                ui::Text("%s: %u", GetGaugeName(static_cast<Gauge>(i)), _gauges[i]);
+#if UIEDITOR_ALLOCATION_TRACKING
+            ui::Separator();
+            RenderAllocationSites();
+#endif
+        }
+        ui::End();
+    }
+
+    static const char* GetPhaseName(Phase phase)
+    {
+        static const char* names[] = {"Frame", "OnUpdate", "UI::Render", "DebugRenderer::Render", "RenderUITree",
+            "RenderAttributes", "GetStyleData"};
+        return names[phase];
+    }
+
+    static const char* GetCounterName(Counter counter)
+    {
+        static const char* names[] = {"XPath queries", "ApplyAttributes calls", "Undo pushes", "Restyled elements"};
+        return names[counter];
+    }
+
+    static const char* GetGaugeName(Gauge gauge)
+    {
+        static const char* names[] = {"Edit buffer bytes", "Style indexed elements"};
+        return names[gauge];
+    }
+
+protected:
+    void OnBeginFrame()
+    {
+#if UIEDITOR_ALLOCATION_TRACKING
+        AllocationTracker::EndFrame();
+#endif
+        if (!_enabled)
+            return;
+
+        auto now = Clock::now();
+        _current_time[PHASE_FRAME] = now - _frame_start;
+        _frame_start = now;
+
+        for (auto i = 0; i < PHASE_COUNT; i++)
+        {
+            _time_history[i][_history_head] = std::chrono::duration<float, std::milli>(_current_time[i]).count();
+            _current_time[i] = Clock::duration::zero();
+        }
+        for (auto i = 0; i < COUNTER_COUNT; i++)
+        {
+            _count_history[i][_history_head] = _current_count[i];
+            _current_count[i] = 0;
+        }
+
+        _history_head = (_history_head + 1) % HISTORY_SIZE;
+        if (_history_size < HISTORY_SIZE)
+            _history_size++;
+    }
+
+    void RenderHistory(const char* label, const float* history, const char* unit)
+    {
+        if (_history_size == 0)
+        {
+            ui::Text("%s: no data", label);
+            return;
+        }
+
+        // Oldest sample is at head once history wrapped around.
+        auto offset = _history_size < HISTORY_SIZE ? 0 : _history_head;
+        auto min = history[offset], max = history[offset], sum = 0.f;
+        for (unsigned i = 0; i < _history_size; i++)
+        {
+            auto value = history[i];
+            min = Min(min, value);
+            max = Max(max, value);
+            sum += value;
+        }
+
+        char overlay[128];
+        snprintf(overlay, sizeof(overlay), "min %.2f%s  avg %.2f%s  max %.2f%s", min, unit, sum / _history_size, unit,
+                 max, unit);
+        ui::TextUnformatted(label);
+        ui::PushID(label);
+        ui::PlotLines("", history, _history_size, offset, overlay, 0.f, max > 0 ? max * 1.1f : 1.f, {440.f, 40.f});
+        ui::PopID();
+    }
+
+#if UIEDITOR_ALLOCATION_TRACKING
+    void RenderAllocationSites()
+    {
+        AllocationSite sites[AllocationTracker::MAX_SITES];
+        auto count = AllocationTracker::GetFrameSites(sites, AllocationTracker::MAX_SITES);
+        unsigned total_count = 0;
+        unsigned long long total_bytes = 0;
+        for (unsigned i = 0; i < count; i++)
+        {
+            total_count += sites[i].count;
+            total_bytes += sites[i].bytes;
+        }
+
+        ui::Text("Heap allocations last frame: %u (%llu bytes)", total_count, total_bytes);
+        ui::Columns(3);
+        ui::TextUnformatted("Scope");
+        ui::NextColumn();
+        ui::TextUnformatted("Allocations");
+        ui::NextColumn();
+        ui::TextUnformatted("Bytes");
+        ui::NextColumn();
+        for (unsigned i = 0; i < count; i++)
+        {
+            ui::TextUnformatted(sites[i].name);
+            ui::NextColumn();
+            ui::Text("%u", sites[i].count);
+            ui::NextColumn();
+            ui::Text("%llu", sites[i].bytes);
+            ui::NextColumn();
+        }
+        ui::Columns(1);
+    }
+#endif
+
+    bool _enabled = false;
+    WeakPtr<TraceRecorder> _trace;
+    Clock::time_point _frame_start;
+    Clock::duration _current_time[PHASE_COUNT]{};
+    unsigned _current_count[COUNTER_COUNT]{};
+    unsigned _gauges[GAUGE_COUNT]{};
+    float _time_history[PHASE_COUNT][HISTORY_SIZE]{};
+    float _count_history[COUNTER_COUNT][HISTORY_SIZE]{};
+    unsigned _history_head = 0;
+    unsigned _history_size = 0;
+};
+
+/// Adds time spent in enclosing block to a profiler phase. Does nothing while profiler is inactive.
+class FrameProfileScope
+{
+public:
+    FrameProfileScope(FrameProfiler* profiler, FrameProfiler::Phase phase)
+        : _profiler(profiler != nullptr && profiler->IsActive() ? profiler : nullptr)
+        , _phase(phase)
+        , _allocation_scope(FrameProfiler::GetPhaseName(phase))
+    {
+        if (_profiler)
+            _start = FrameProfiler::Clock::now();
+    }
+
+    ~FrameProfileScope()
+    {
+        if (_profiler)
+            _profiler->AddTime(_phase, _start, FrameProfiler::Clock::now());
+    }
+
+protected:
+    FrameProfiler* _profiler;
+    FrameProfiler::Phase _phase;
+    FrameProfiler::Clock::time_point _start;
+    AllocationScope _allocation_scope;
+};
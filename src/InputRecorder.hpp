@@ -0,0 +1,272 @@
+#pragma once
+
+
+#include <Atomic/Core/Context.h>
+#include <Atomic/Core/Object.h>
+#include <Atomic/Core/Variant.h>
+#include <Atomic/Input/Input.h>
+#include <Atomic/IO/File.h>
+
+using namespace Atomic;
+
+
+/// Mouse buttons editor logic reads.
+static const int RECORDED_BUTTONS[] = {MOUSEB_LEFT, MOUSEB_MIDDLE, MOUSEB_RIGHT};
+static const unsigned NUM_RECORDED_BUTTONS = sizeof(RECORDED_BUTTONS) / sizeof(RECORDED_BUTTONS[0]);
+/// Keys editor logic reads, other keys are not recorded.
+static const int RECORDED_KEYS[] = {KEY_DELETE, KEY_SHIFT, KEY_CTRL, KEY_Y, KEY_Z};
+static const unsigned NUM_RECORDED_KEYS = sizeof(RECORDED_KEYS) / sizeof(RECORDED_KEYS[0]);
+
+/// Editor operation that does not come from viewport input, for example menu item or attribute edit.
+struct InputAction
+{
+    String name;
+    String argument;
+    Variant value;
+};
+
+/// Input state of a single frame as seen by editor logic.
+struct InputFrame
+{
+    unsigned frame = 0;
+    IntVector2 mouse_position;
+    IntVector2 mouse_move;
+    /// Bit masks of RECORDED_BUTTONS.
+    unsigned buttons_down = 0;
+    unsigned buttons_pressed = 0;
+    /// Bit masks of indices into RECORDED_KEYS.
+    unsigned keys_down = 0;
+    unsigned keys_pressed = 0;
+    /// Rect of UI root, it depends on imgui windows which are not rendered during replay.
+    IntVector2 root_position;
+    IntVector2 root_size;
+    /// Imgui widget had focus, keyboard shortcuts are ignored.
+    bool item_active = false;
+    Vector<InputAction> actions;
+
+    /// Return true if frame only continues state of `previous`, such frames are not stored.
+    bool IsRepeatOf(const InputFrame& previous) const
+    {
+        return mouse_move == IntVector2::ZERO && buttons_pressed == 0 && keys_pressed == 0 && actions.Empty() &&
+               mouse_position == previous.mouse_position && buttons_down == previous.buttons_down &&
+               keys_down == previous.keys_down && root_position == previous.root_position &&
+               root_size == previous.root_size && item_active == previous.item_active;
+    }
+};
+
+/// Source of input for editor logic. Normally it passes through engine input and optionally records it with editor
+/// actions stamped by frame numbers. During replay the same logic reads recorded frames instead.
+class InputRecorder : public Object
+{
+    ATOMIC_OBJECT(InputRecorder, Object);
+public:
+    /// Increment when format of recording changes.
+    static const unsigned VERSION = 1;
+
+    explicit InputRecorder(Context* ctx) : Object(ctx) { }
+
+    /// Capture input of new frame, or advance to next recorded frame during replay.
+    void BeginFrame()
+    {
+        if (_replaying)
+        {
+            AdvanceReplay();
+            return;
+        }
+
+        if (_recording && (_frames.Empty() || !_current.IsRepeatOf(_frames.Back())))
+            _frames.Push(_current);
+
+        auto root_position = _current.root_position;
+        auto root_size = _current.root_size;
+        auto item_active = _current.item_active;
+        _current = InputFrame();
+        _current.frame = _frame_number++;
+        _current.root_position = root_position;
+        _current.root_size = root_size;
+        _current.item_active = item_active;
+
+        auto input = GetSubsystem<Input>();
+        if (input == nullptr)
+            return;
+        _current.mouse_position = input->GetMousePosition();
+        _current.mouse_move = input->GetMouseMove();
+        for (unsigned i = 0; i < NUM_RECORDED_BUTTONS; i++)
+        {
+            if (input->GetMouseButtonDown(RECORDED_BUTTONS[i]))
+                _current.buttons_down |= RECORDED_BUTTONS[i];
+            if (input->GetMouseButtonPress(RECORDED_BUTTONS[i]))
+                _current.buttons_pressed |= RECORDED_BUTTONS[i];
+        }
+        for (unsigned i = 0; i < NUM_RECORDED_KEYS; i++)
+        {
+            if (input->GetKeyDown(RECORDED_KEYS[i]))
+                _current.keys_down |= 1u << i;
+            if (input->GetKeyPress(RECORDED_KEYS[i]))
+                _current.keys_pressed |= 1u << i;
+        }
+    }
+
+    IntVector2 GetMousePosition() const { return _current.mouse_position; }
+    IntVector2 GetMouseMove() const { return _current.mouse_move; }
+    bool GetMouseButtonDown(int button) const { return (_current.buttons_down & button) != 0; }
+    bool GetMouseButtonPress(int button) const { return (_current.buttons_pressed & button) != 0; }
+    bool GetKeyDown(int key) const { return (_current.keys_down & GetKeyMask(key)) != 0; }
+    bool GetKeyPress(int key) const { return (_current.keys_pressed & GetKeyMask(key)) != 0; }
+
+    /// Store rect of UI root laid out during current frame. Replay applies it instead of laying out imgui panels.
+    void SetRootRect(const IntVector2& position, const IntVector2& size)
+    {
+        _current.root_position = position;
+        _current.root_size = size;
+    }
+    const IntVector2& GetRootPosition() const { return _current.root_position; }
+    const IntVector2& GetRootSize() const { return _current.root_size; }
+    void SetItemActive(bool active) { _current.item_active = active; }
+    bool IsItemActive() const { return _current.item_active; }
+
+    /// Record editor action in current frame.
+    void RecordAction(const String& name, const String& argument = String::EMPTY,
+                      const Variant& value = Variant::EMPTY)
+    {
+        if (!_recording)
+            return;
+
+        InputAction action;
+        action.name = name;
+        action.argument = argument;
+        action.value = value;
+        _current.actions.Push(action);
+    }
+
+    /// Return actions of current frame during replay.
+    const Vector<InputAction>& GetActions() const { return _current.actions; }
+
+    void StartRecording(const String& file_path)
+    {
+        _recording_path = file_path;
+        _recording = true;
+        _frames.Clear();
+        _frame_number = 0;
+        _current.frame = _frame_number++;
+    }
+
+    /// Stop recording and save it. Return false when file could not be written.
+    bool StopRecording()
+    {
+        if (!_recording)
+            return true;
+
+        _frames.Push(_current);
+        _recording = false;
+
+        File file(context_, _recording_path, FILE_WRITE);
+        if (!file.IsOpen())
+            return false;
+
+        file.WriteFileID("UIRC");
+        file.WriteUInt(VERSION);
+        file.WriteVLE(_frames.Size());
+        for (const auto& frame: _frames)
+        {
+            file.WriteUInt(frame.frame);
+            file.WriteIntVector2(frame.mouse_position);
+            file.WriteIntVector2(frame.mouse_move);
+            file.WriteUByte(static_cast<unsigned char>(frame.buttons_down));
+            file.WriteUByte(static_cast<unsigned char>(frame.buttons_pressed));
+            file.WriteUByte(static_cast<unsigned char>(frame.keys_down));
+            file.WriteUByte(static_cast<unsigned char>(frame.keys_pressed));
+            file.WriteIntVector2(frame.root_position);
+            file.WriteIntVector2(frame.root_size);
+            file.WriteBool(frame.item_active);
+            file.WriteVLE(frame.actions.Size());
+            for (const auto& action: frame.actions)
+            {
+                file.WriteString(action.name);
+                file.WriteString(action.argument);
+                file.WriteVariant(action.value);
+            }
+        }
+        _frames.Clear();
+        return true;
+    }
+
+    bool IsRecording() const { return _recording; }
+
+    /// Load recording saved by StopRecording() and start replaying it from next BeginFrame().
+    bool StartReplay(const String& file_path)
+    {
+        File file(context_, file_path);
+        if (!file.IsOpen() || file.ReadFileID() != "UIRC" || file.ReadUInt() != VERSION)
+            return false;
+
+        _frames.Resize(file.ReadVLE());
+        for (auto& frame: _frames)
+        {
+            frame.frame = file.ReadUInt();
+            frame.mouse_position = file.ReadIntVector2();
+            frame.mouse_move = file.ReadIntVector2();
+            frame.buttons_down = file.ReadUByte();
+            frame.buttons_pressed = file.ReadUByte();
+            frame.keys_down = file.ReadUByte();
+            frame.keys_pressed = file.ReadUByte();
+            frame.root_position = file.ReadIntVector2();
+            frame.root_size = file.ReadIntVector2();
+            frame.item_active = file.ReadBool();
+            frame.actions.Resize(file.ReadVLE());
+            for (auto& action: frame.actions)
+            {
+                action.name = file.ReadString();
+                action.argument = file.ReadString();
+                action.value = file.ReadVariant();
+            }
+        }
+        _replaying = true;
+        _next_frame = 0;
+        _frame_number = 0;
+        _current = InputFrame();
+        return true;
+    }
+
+    bool IsReplaying() const { return _replaying; }
+    /// Return true when last recorded frame was replayed.
+    bool IsReplayFinished() const { return _replaying && _next_frame >= _frames.Size(); }
+    /// Return number of frames in recording, including frames that were not stored.
+    unsigned GetNumReplayFrames() const { return _frames.Empty() ? 0 : _frames.Back().frame + 1; }
+
+protected:
+    static unsigned GetKeyMask(int key)
+    {
+        for (unsigned i = 0; i < NUM_RECORDED_KEYS; i++)
+        {
+            if (RECORDED_KEYS[i] == key)
+                return 1u << i;
+        }
+        return 0;
+    }
+
+    void AdvanceReplay()
+    {
+        if (_next_frame < _frames.Size() && _frames[_next_frame].frame == _frame_number)
+            _current = _frames[_next_frame++];
+        else
+        {
+            // Frame that was not stored repeats previous state.
+            _current.frame = _frame_number;
+            _current.mouse_move = IntVector2::ZERO;
+            _current.buttons_pressed = 0;
+            _current.keys_pressed = 0;
+            _current.actions.Clear();
+        }
+        _frame_number++;
+    }
+
+    bool _recording = false;
+    bool _replaying = false;
+    String _recording_path;
+    Vector<InputFrame> _frames;
+    InputFrame _current;
+    unsigned _frame_number = 0;
+    /// Index of next stored frame to replay.
+    unsigned _next_frame = 0;
+};
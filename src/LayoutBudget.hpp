@@ -0,0 +1,156 @@
+#pragma once
+
+
+#include <Atomic/Core/Context.h>
+#include <Atomic/IO/FileSystem.h>
+#include <Atomic/Resource/JSONFile.h>
+
+#include <UrhoUI.h>
+
+using namespace Atomic;
+using namespace Atomic::UrhoUI;
+
+
+/// Measured properties of a layout that budgets limit.
+struct LayoutMetrics
+{
+    /// Number of elements, internal elements are not counted.
+    unsigned elements = 0;
+    /// Depth of deepest element, top level element has depth 1.
+    unsigned depth = 0;
+    unsigned draw_calls = 0;
+    /// Number of distinct textures used by batches.
+    unsigned textures = 0;
+    float overdraw = 0;
+    /// Size of saved layout file in bytes.
+    unsigned file_size = 0;
+};
+
+/// Metric that exceeds its limit.
+struct BudgetViolation
+{
+    String name;
+    float value;
+    float limit;
+};
+
+/// Performance budget of a layout loaded from JSON file, for example `{"max_elements": 500, "max_overdraw": 2.5}`.
+/// Limits are `max_elements`, `max_depth`, `max_draw_calls`, `max_textures`, `max_overdraw` and `max_file_size`,
+/// missing or zero limits are not checked.
+class LayoutBudget
+{
+public:
+    /// Load budget from `file_path`. Return false when file does not exist or is not a JSON object.
+    bool Load(Context* context, const String& file_path)
+    {
+        Clear();
+        if (!context->GetSubsystem<FileSystem>()->FileExists(file_path))
+            return false;
+
+        JSONFile json(context);
+        if (!json.LoadFile(file_path) || !json.GetRoot().IsObject())
+        {
+            _error = "Budget file is not a JSON object: " + file_path;
+            return false;
+        }
+
+        const auto& root = json.GetRoot();
+        for (unsigned i = 0; i < NUM_LIMITS; i++)
+        {
+            const auto& value = root[GetLimitName(i)];
+            if (value.IsNumber())
+                _limits[i] = value.GetFloat();
+        }
+        _file_path = file_path;
+        return true;
+    }
+
+    void Clear()
+    {
+        for (auto& limit: _limits)
+            limit = 0;
+        _file_path.Clear();
+        _error.Clear();
+    }
+
+    /// Return limits that `metrics` exceed.
+    Vector<BudgetViolation> Check(const LayoutMetrics& metrics) const
+    {
+        const float values[NUM_LIMITS] = {static_cast<float>(metrics.elements), static_cast<float>(metrics.depth),
+                                          static_cast<float>(metrics.draw_calls),
+                                          static_cast<float>(metrics.textures), metrics.overdraw,
+                                          static_cast<float>(metrics.file_size)};
+        Vector<BudgetViolation> violations;
+        for (unsigned i = 0; i < NUM_LIMITS; i++)
+        {
+            if (_limits[i] > 0 && values[i] > _limits[i])
+                violations.Push(BudgetViolation{String(GetLimitName(i)).Substring(4), values[i], _limits[i]});
+        }
+        return violations;
+    }
+
+    /// Return path of loaded budget file, empty when none is loaded.
+    const String& GetFilePath() const { return _file_path; }
+    /// Return error of last Load(). Missing budget file is not an error.
+    const String& GetError() const { return _error; }
+
+    /// Return budget file belonging to layout, `Menu.xml` has `Menu.budget.json` next to it.
+    static String GetBudgetPath(const String& layout_path)
+    {
+        return GetPath(layout_path) + GetFileName(layout_path) + ".budget.json";
+    }
+
+    /// Return violations as JSON array of objects with `name`, `value` and `limit` for batch reports.
+    static JSONArray ToJSON(const Vector<BudgetViolation>& violations)
+    {
+        JSONArray result;
+        for (const auto& violation: violations)
+        {
+            JSONValue value;
+            value["name"] = violation.name;
+            value["value"] = violation.value;
+            value["limit"] = violation.limit;
+            result.Push(value);
+        }
+        return result;
+    }
+
+    /// Count elements and depth of layout below `element` into `metrics`.
+    static void MeasureTree(UIElement* element, LayoutMetrics& metrics, unsigned depth = 1)
+    {
+        if (element == nullptr || element->IsInternal())
+            return;
+
+        metrics.elements++;
+        metrics.depth = Max(metrics.depth, depth);
+        for (const auto& child: element->GetChildren())
+            MeasureTree(child, metrics, depth + 1);
+    }
+
+    /// Format violations for status bar, for example "elements 612/500, overdraw 3.1/2.5".
+    static String ToString(const Vector<BudgetViolation>& violations)
+    {
+        String text;
+        for (const auto& violation: violations)
+        {
+            if (!text.Empty())
+                text += ", ";
+            text += Atomic::ToString("%s %g/%g", violation.name.CString(), violation.value, violation.limit);
+        }
+        return text;
+    }
+
+protected:
+    static const unsigned NUM_LIMITS = 6;
+
+    static const char* GetLimitName(unsigned index)
+    {
+        static const char* names[NUM_LIMITS] = {"max_elements", "max_depth", "max_draw_calls", "max_textures",
+                                                "max_overdraw", "max_file_size"};
+        return names[index];
+    }
+
+    float _limits[NUM_LIMITS] = {};
+    String _file_path;
+    String _error;
+};
@@ -0,0 +1,298 @@
+#pragma once
+
+
+#include <Atomic/Container/HashMap.h>
+#include <Atomic/Core/Context.h>
+#include <Atomic/Core/Object.h>
+
+#include <UrhoUI.h>
+
+#include <cctype>
+
+using namespace Atomic;
+using namespace Atomic::UrhoUI;
+
+
+/// Turns element tree into C++ code that constructs the same tree. Generated code sets every attribute that differs
+/// from a freshly constructed element by attribute index, style is already applied to values, so neither XML nor
+/// attribute names are touched at runtime.
+class LayoutCodeGenerator : public Object
+{
+    ATOMIC_OBJECT(LayoutCodeGenerator, Object);
+public:
+    explicit LayoutCodeGenerator(Context* ctx) : Object(ctx) { }
+
+    /// Return header with inline function `function_name` that creates `root` and its descendants.
+    String Generate(UIElement* root, const String& function_name, const String& source_name)
+    {
+        _code.Clear();
+        _num_elements = 0;
+        _num_attributes = 0;
+        _skipped.Clear();
+
+        _code += "// Generated by UrhoUIEditor from " + source_name + ", do not edit.\n";
+        _code += "// Attribute indices match engine build used for generation, regenerate after updating engine.\n";
+        _code += "#pragma once\n\n";
+        _code += "#include <Atomic/Core/Context.h>\n";
+        _code += "#include <UrhoUI.h>\n\n";
+        _code += "#include <limits>\n\n";
+        _code += "inline Atomic::SharedPtr<Atomic::UrhoUI::UIElement> " + function_name + "(Atomic::Context* context)\n";
+        _code += "{\n";
+        _code += "    using namespace Atomic;\n";
+        _code += "    using namespace Atomic::UrhoUI;\n\n";
+        _code += ToString("    SharedPtr<UIElement> root(StaticCast<UIElement>(context->CreateObject(StringHash(0x%08XU)))); "
+                          "// %s\n", root->GetType().Value(), root->GetTypeName().CString());
+        _code += "    UIElement* e0 = root;\n";
+        GenerateElement(root, "e0");
+        _code += "    return root;\n";
+        _code += "}\n";
+
+        _fresh_elements.Clear();
+        return _code;
+    }
+
+    unsigned GetNumElements() const { return _num_elements; }
+    unsigned GetNumAttributes() const { return _num_attributes; }
+    /// Return names of attributes that could not be expressed in C++.
+    const Vector<String>& GetSkippedAttributes() const { return _skipped; }
+
+    /// Return C++ identifier made from file name, for example "main_menu.xml" becomes "CreateMainMenu".
+    static String MakeFunctionName(const String& file_path)
+    {
+        String name = "Create";
+        auto upper = true;
+        for (auto c: GetFileName(file_path))
+        {
+            if (!isalnum(static_cast<unsigned char>(c)))
+            {
+                upper = true;
+                continue;
+            }
+            name += upper ? static_cast<char>(toupper(static_cast<unsigned char>(c))) : c;
+            upper = false;
+        }
+        return name;
+    }
+
+    /// Return C++ expression constructing `value` or empty string when type is not supported.
+    static String ToCpp(const Variant& value)
+    {
+        switch (value.GetType())
+        {
+        case VAR_INT:
+            return String(value.GetInt());
+        case VAR_BOOL:
+            return value.GetBool() ? "true" : "false";
+        case VAR_FLOAT:
+            return ToCpp(value.GetFloat());
+        case VAR_DOUBLE:
+            return ToString("%.17g", value.GetDouble());
+        case VAR_INT64:
+            return ToString("%lldLL", value.GetInt64());
+        case VAR_VECTOR2:
+        {
+            const auto& v = value.GetVector2();
+            return "Vector2(" + ToCpp(v.x_) + ", " + ToCpp(v.y_) + ")";
+        }
+        case VAR_VECTOR3:
+        {
+            const auto& v = value.GetVector3();
+            return "Vector3(" + ToCpp(v.x_) + ", " + ToCpp(v.y_) + ", " + ToCpp(v.z_) + ")";
+        }
+        case VAR_VECTOR4:
+        {
+            const auto& v = value.GetVector4();
+            return "Vector4(" + ToCpp(v.x_) + ", " + ToCpp(v.y_) + ", " + ToCpp(v.z_) + ", " + ToCpp(v.w_) + ")";
+        }
+        case VAR_QUATERNION:
+        {
+            const auto& v = value.GetQuaternion();
+            return "Quaternion(" + ToCpp(v.w_) + ", " + ToCpp(v.x_) + ", " + ToCpp(v.y_) + ", " + ToCpp(v.z_) + ")";
+        }
+        case VAR_COLOR:
+        {
+            const auto& v = value.GetColor();
+            return "Color(" + ToCpp(v.r_) + ", " + ToCpp(v.g_) + ", " + ToCpp(v.b_) + ", " + ToCpp(v.a_) + ")";
+        }
+        case VAR_RECT:
+        {
+            const auto& v = value.GetRect();
+            return "Rect(" + ToCpp(v.min_.x_) + ", " + ToCpp(v.min_.y_) + ", " + ToCpp(v.max_.x_) + ", " +
+                   ToCpp(v.max_.y_) + ")";
+        }
+        case VAR_INTRECT:
+        {
+            const auto& v = value.GetIntRect();
+            return ToString("IntRect(%d, %d, %d, %d)", v.left_, v.top_, v.right_, v.bottom_);
+        }
+        case VAR_INTVECTOR2:
+        {
+            const auto& v = value.GetIntVector2();
+            return ToString("IntVector2(%d, %d)", v.x_, v.y_);
+        }
+        case VAR_INTVECTOR3:
+        {
+            const auto& v = value.GetIntVector3();
+            return ToString("IntVector3(%d, %d, %d)", v.x_, v.y_, v.z_);
+        }
+        case VAR_STRING:
+            return "String(" + ToCppString(value.GetString()) + ")";
+        case VAR_RESOURCEREF:
+        {
+            const auto& ref = value.GetResourceRef();
+            return ToString("ResourceRef(StringHash(0x%08XU), ", ref.type_.Value()) + ToCppString(ref.name_) + ")";
+        }
+        case VAR_RESOURCEREFLIST:
+        {
+            const auto& refs = value.GetResourceRefList();
+            String code = ToString("[]() { ResourceRefList v(StringHash(0x%08XU)); ", refs.type_.Value());
+            for (const auto& name: refs.names_)
+                code += "v.names_.Push(" + ToCppString(name) + "); ";
+            return code + "return v; }()";
+        }
+        case VAR_STRINGVECTOR:
+        {
+            String code = "[]() { StringVector v; ";
+            for (const auto& item: value.GetStringVector())
+                code += "v.Push(" + ToCppString(item) + "); ";
+            return code + "return v; }()";
+        }
+        case VAR_VARIANTVECTOR:
+        {
+            String code = "[]() { VariantVector v; ";
+            for (const auto& item: value.GetVariantVector())
+            {
+                auto item_code = ToCpp(item);
+                if (item_code.Empty())
+                    return String::EMPTY;
+                code += "v.Push(Variant(" + item_code + ")); ";
+            }
+            return code + "return v; }()";
+        }
+        case VAR_VARIANTMAP:
+        {
+            String code = "[]() { VariantMap v; ";
+            for (const auto& it: value.GetVariantMap())
+            {
+                auto item_code = ToCpp(it.second_);
+                if (item_code.Empty())
+                    return String::EMPTY;
+                code += ToString("v[StringHash(0x%08XU)] = ", it.first_.Value()) + item_code + "; ";
+            }
+            return code + "return v; }()";
+        }
+        default:
+            return String::EMPTY;
+        }
+    }
+
+protected:
+    static String ToCpp(float value)
+    {
+        if (IsNaN(value))
+            return "std::numeric_limits<float>::quiet_NaN()";
+        if (value == M_INFINITY || value == -M_INFINITY)
+            return value > 0 ? "M_INFINITY" : "-M_INFINITY";
+
+        // Float literal needs decimal point or exponent.
+        auto code = ToString("%.9g", value);
+        if (!code.Contains('.') && !code.Contains('e'))
+            code += ".0";
+        return code + "f";
+    }
+
+    static String ToCppString(const String& value)
+    {
+        String code = "\"";
+        for (auto c: value)
+        {
+            switch (c)
+            {
+            case '\\': code += "\\\\"; break;
+            case '"': code += "\\\""; break;
+            case '\n': code += "\\n"; break;
+            case '\r': code += "\\r"; break;
+            case '\t': code += "\\t"; break;
+            default:
+                // Octal escapes, unlike hex ones, never consume following characters.
+                if (static_cast<unsigned char>(c) < 0x20)
+                    code += ToString("\\%03o", static_cast<unsigned char>(c));
+                else
+                    code += c;
+                break;
+            }
+        }
+        return code + "\"";
+    }
+
+    /// Return element of same type in its constructed state.
+    UIElement* GetFreshElement(StringHash type)
+    {
+        auto it = _fresh_elements.Find(type);
+        if (it != _fresh_elements.End())
+            return it->second_;
+
+        SharedPtr<UIElement> element(StaticCast<UIElement>(context_->CreateObject(type)));
+        _fresh_elements[type] = element;
+        return element;
+    }
+
+    void GenerateElement(UIElement* element, const String& variable)
+    {
+        _num_elements++;
+        auto fresh = GetFreshElement(element->GetType());
+        const auto* attributes = element->GetAttributes();
+        auto has_attributes = false;
+        for (unsigned i = 0; attributes != nullptr && i < attributes->Size(); i++)
+        {
+            const auto& info = attributes->At(i);
+            if ((info.mode_ & AM_FILE) == 0)
+                continue;
+
+            auto value = element->GetAttribute(i);
+            if (fresh != nullptr && fresh->GetAttribute(i) == value)
+                continue;
+
+            auto code = ToCpp(value);
+            if (code.Empty())
+            {
+                _skipped.Push(element->GetTypeName() + "." + info.name_);
+                _code += "    // " + info.name_ + ": " + String(Variant::GetTypeName(value.GetType())) +
+                         " is not supported.\n";
+                continue;
+            }
+
+            _code += ToString("    %s->SetAttribute(%uu, ", variable.CString(), i) + code + "); // " + info.name_ + "\n";
+            _num_attributes++;
+            has_attributes = true;
+        }
+        if (has_attributes)
+            _code += "    " + variable + "->ApplyAttributes();\n";
+
+        const auto& children = element->GetChildren();
+        for (unsigned i = 0; i < children.Size(); i++)
+        {
+            UIElement* child = children[i];
+            auto child_variable = ToString("e%u", _num_elements);
+            if (child->IsInternal())
+            {
+                // Internal elements are created by their parent.
+                _code += ToString("    UIElement* %s = %s->GetChild(%uu); // %s\n", child_variable.CString(),
+                                  variable.CString(), i, child->GetTypeName().CString());
+            }
+            else
+            {
+                _code += ToString("    UIElement* %s = %s->CreateChild(StringHash(0x%08XU)); // %s\n",
+                                  child_variable.CString(), variable.CString(), child->GetType().Value(),
+                                  child->GetTypeName().CString());
+            }
+            GenerateElement(child, child_variable);
+        }
+    }
+
+    String _code;
+    unsigned _num_elements = 0;
+    unsigned _num_attributes = 0;
+    Vector<String> _skipped;
+    HashMap<StringHash, SharedPtr<UIElement>> _fresh_elements;
+};
@@ -0,0 +1,310 @@
+#pragma once
+
+
+#include <Atomic/Container/Pair.h>
+#include <Atomic/Container/Vector.h>
+#include <Atomic/Resource/XMLFile.h>
+
+#include <UrhoUI.h>
+
+#include "ElementUtils.hpp"
+
+using namespace Atomic;
+using namespace Atomic::UrhoUI;
+
+
+/// Parameters of synthetic layout. Same settings and style always produce the same layout.
+struct LayoutGeneratorSettings
+{
+    int seed = 1;
+    /// Number of elements including top level element.
+    int elements = 1000;
+    /// Maximal depth, top level element has depth 1.
+    int max_depth = 8;
+    /// Maximal number of children of a single element.
+    int max_children = 8;
+    /// Element types with relative weights, `Button:2,Text:5`. Empty string uses all UI_ELEMENT_TYPES equally.
+    String types;
+    /// Fraction of elements that use a style derived from style of their type instead of the type style itself.
+    float styled = 0.25f;
+    /// Range of text length in characters of Text elements.
+    int min_text_length = 4;
+    int max_text_length = 32;
+    /// Range of font size of Text elements, zero keeps size from style.
+    int min_font_size = 0;
+    int max_font_size = 0;
+
+    /// Set parameter from `--name=value` option. Return false if name is unknown or value is invalid.
+    bool SetOption(const String& name, const String& value)
+    {
+        if (name == "seed")
+            seed = ToInt(value);
+        else if (name == "elements")
+            elements = ToInt(value);
+        else if (name == "depth")
+            max_depth = ToInt(value);
+        else if (name == "fan-out")
+            max_children = ToInt(value);
+        else if (name == "types")
+            types = value;
+        else if (name == "styled")
+            styled = ToFloat(value);
+        else if (name == "text-length")
+            return ParseRange(value, min_text_length, max_text_length);
+        else if (name == "font-size")
+            return ParseRange(value, min_font_size, max_font_size);
+        else
+            return false;
+        return true;
+    }
+
+    /// Return settings as space separated `name=value` options accepted by SetOption().
+    String ToString() const
+    {
+        auto options = Atomic::ToString("seed=%d elements=%d depth=%d fan-out=%d styled=%g text-length=%d-%d "
+                                        "font-size=%d-%d", seed, elements, max_depth, max_children, styled,
+                                        min_text_length, max_text_length, min_font_size, max_font_size);
+        if (!types.Empty())
+            options += " types=" + types.Replaced(" ", "");
+        return options;
+    }
+
+    /// Parse options made by ToString().
+    bool FromString(const String& options)
+    {
+        for (const auto& option: options.Split(' '))
+        {
+            auto separator = option.Find('=');
+            if (separator == String::NPOS ||
+                !SetOption(option.Substring(0, separator), option.Substring(separator + 1)))
+                return false;
+        }
+        return true;
+    }
+
+    /// Names of options understood by SetOption().
+    static const char** GetOptionNames()
+    {
+        static const char* names[] = {"seed", "elements", "depth", "fan-out", "types", "styled", "text-length",
+                                      "font-size", 0};
+        return names;
+    }
+
+protected:
+    /// Parse `min-max` or a single number.
+    static bool ParseRange(const String& value, int& min, int& max)
+    {
+        auto parts = value.Split('-');
+        if (parts.Empty() || parts.Size() > 2)
+            return false;
+        min = ToInt(parts.Front());
+        max = ToInt(parts.Back());
+        return min <= max;
+    }
+};
+
+/// Creates reproducible synthetic layouts of configurable size and shape for stress testing and benchmarks. Random
+/// numbers come from generator's own xorshift state, so layouts do not depend on platform or other users of Rand().
+class LayoutGenerator
+{
+public:
+    /// Create layout under `parent` and return its top level element. `style_root` is root of style sheet used to
+    /// pick derived styles, it may be null.
+    UIElement* Generate(UIElement* parent, const LayoutGeneratorSettings& settings, const XMLElement& style_root)
+    {
+        _state = static_cast<unsigned>(settings.seed) * 2654435761u ^ 0x9E3779B9u;
+        if (_state == 0)
+            _state = 1;
+        _settings = settings;
+        _num_elements = 0;
+        _depth = 0;
+        CollectTypes();
+        CollectStyles(style_root);
+
+        struct OpenParent
+        {
+            UIElement* element;
+            unsigned depth;
+            unsigned children;
+        };
+        Vector<OpenParent> open;
+
+        auto root = parent->CreateChild<UIElement>();
+        root->SetStyleAuto();
+        root->SetSize(parent->GetSize());
+        _num_elements = 1;
+        _depth = 1;
+        if (settings.max_depth > 1 && settings.max_children > 0)
+            open.Push(OpenParent{root, 1, 0});
+
+        while (_num_elements < static_cast<unsigned>(Max(settings.elements, 1)) && !open.Empty())
+        {
+            auto index = Random(open.Size());
+            auto& entry = open[index];
+            auto element = CreateElement(entry.element);
+            auto depth = entry.depth + 1;
+            _num_elements++;
+            _depth = Max(_depth, depth);
+
+            if (++entry.children >= static_cast<unsigned>(settings.max_children))
+            {
+                open[index] = open.Back();
+                open.Pop();
+            }
+            if (depth < static_cast<unsigned>(settings.max_depth))
+                open.Push(OpenParent{element, depth, 0});
+        }
+        return root;
+    }
+
+    /// Return number of elements created by last Generate(), internal elements are not counted.
+    unsigned GetNumElements() const { return _num_elements; }
+    /// Return depth of deepest element created by last Generate().
+    unsigned GetDepth() const { return _depth; }
+    /// Return invalid entries of type list of last Generate(), they were ignored.
+    const Vector<String>& GetUnknownTypes() const { return _unknown_types; }
+
+protected:
+    UIElement* CreateElement(UIElement* parent)
+    {
+        const auto& type = PickType();
+        auto element = parent->CreateChild(StringHash(type));
+
+        const auto& derived = _derived_styles[type];
+        if (!derived.Empty() && RandomFloat() < _settings.styled)
+            element->SetStyle(derived[Random(derived.Size())]);
+        else
+            element->SetStyleAuto();
+
+        // Evaluation order of function arguments is unspecified, every random number is drawn by its own statement.
+        auto parent_size = parent->GetSize();
+        IntVector2 size;
+        size.x_ = RandomRange(16, Max(16, parent_size.x_ / 2));
+        size.y_ = RandomRange(16, Max(16, parent_size.y_ / 2));
+        IntVector2 position;
+        position.x_ = RandomRange(0, Max(0, parent_size.x_ - size.x_));
+        position.y_ = RandomRange(0, Max(0, parent_size.y_ - size.y_));
+        element->SetSize(size);
+        element->SetPosition(position);
+
+        if (element->GetType() == Text::GetTypeStatic())
+        {
+            auto text = static_cast<Text*>(element);
+            auto length = RandomRange(Max(_settings.min_text_length, 0), Max(_settings.max_text_length, 0));
+            String value;
+            value.Resize(static_cast<unsigned>(length));
+            for (auto i = 0; i < length; i++)
+                value[i] = i % 6 == 5 ? ' ' : static_cast<char>('a' + Random(26));
+            text->SetText(value);
+
+            if (_settings.max_font_size > 0 && text->GetFont() != nullptr)
+                text->SetFont(text->GetFont(), RandomRange(Max(_settings.min_font_size, 1), _settings.max_font_size));
+        }
+        return element;
+    }
+
+    /// Parse weighted type list.
+    void CollectTypes()
+    {
+        _types.Clear();
+        _unknown_types.Clear();
+        _total_weight = 0;
+        if (_settings.types.Trimmed().Empty())
+        {
+            for (auto i = 0; UI_ELEMENT_TYPES[i] != 0; i++)
+                _types.Push(MakePair(String(UI_ELEMENT_TYPES[i]), 1u));
+        }
+        else
+        {
+            for (const auto& entry: _settings.types.Split(','))
+            {
+                auto separator = entry.Find(':');
+                auto type = entry.Substring(0, separator).Trimmed();
+                auto weight = separator == String::NPOS ? 1u : ToUInt(entry.Substring(separator + 1));
+                auto known = false;
+                for (auto i = 0; UI_ELEMENT_TYPES[i] != 0; i++)
+                    known |= type == UI_ELEMENT_TYPES[i];
+                if (!known || weight == 0)
+                {
+                    _unknown_types.Push(entry);
+                    continue;
+                }
+                _types.Push(MakePair(type, weight));
+            }
+            if (_types.Empty())
+                _types.Push(MakePair(String(UIElement::GetTypeNameStatic()), 1u));
+        }
+        for (const auto& type: _types)
+            _total_weight += type.second_;
+    }
+
+    /// Find styles whose base style chain reaches style of an element type. Styles of element types themselves are
+    /// not derived styles, even when they are based on style of another type.
+    void CollectStyles(const XMLElement& style_root)
+    {
+        _derived_styles.Clear();
+        if (style_root.IsNull())
+            return;
+
+        for (auto style = style_root.GetChild("element"); style.NotNull(); style = style.GetNext("element"))
+        {
+            auto name = style.GetAttribute("type");
+            auto is_type = false;
+            for (auto i = 0; UI_ELEMENT_TYPES[i] != 0; i++)
+                is_type |= name == UI_ELEMENT_TYPES[i];
+            if (is_type)
+                continue;
+
+            auto base = style.GetAttribute("style");
+            for (unsigned depth = 0; !base.Empty() && depth < MAX_STYLE_DEPTH; depth++)
+            {
+                for (auto i = 0; UI_ELEMENT_TYPES[i] != 0; i++)
+                {
+                    if (base == UI_ELEMENT_TYPES[i])
+                        _derived_styles[base].Push(name);
+                }
+                auto base_style = FindStyle(style_root, base);
+                base = base_style.IsNull() ? String::EMPTY : base_style.GetAttribute("style");
+            }
+        }
+    }
+
+    const String& PickType()
+    {
+        auto value = Random(_total_weight);
+        for (const auto& type: _types)
+        {
+            if (value < type.second_)
+                return type.first_;
+            value -= type.second_;
+        }
+        return _types.Back().first_;
+    }
+
+    /// Return random number in range [0, range).
+    unsigned Random(unsigned range)
+    {
+        _state ^= _state << 13;
+        _state ^= _state >> 17;
+        _state ^= _state << 5;
+        return range == 0 ? 0 : _state % range;
+    }
+
+    /// Return random number in range [min, max].
+    int RandomRange(int min, int max)
+    {
+        return min + static_cast<int>(Random(static_cast<unsigned>(max - min + 1)));
+    }
+
+    float RandomFloat() { return Random(1u << 24) / static_cast<float>(1u << 24); }
+
+    LayoutGeneratorSettings _settings;
+    unsigned _state = 1;
+    Vector<Pair<String, unsigned>> _types;
+    unsigned _total_weight = 0;
+    Vector<String> _unknown_types;
+    /// Element type -> styles based on it.
+    HashMap<String, Vector<String>> _derived_styles;
+    unsigned _num_elements = 0;
+    unsigned _depth = 0;
+};
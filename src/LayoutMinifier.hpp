@@ -0,0 +1,96 @@
+#pragma once
+
+
+#include <Atomic/Core/Context.h>
+#include <Atomic/Core/Object.h>
+#include <Atomic/Resource/XMLFile.h>
+
+#include <UrhoUI.h>
+
+#include "ElementUtils.hpp"
+
+using namespace Atomic;
+using namespace Atomic::UrhoUI;
+
+
+/// Removes attributes from serialized layout when element would get the same value from its style or from attribute
+/// default anyway.
+class LayoutMinifier : public Object
+{
+    ATOMIC_OBJECT(LayoutMinifier, Object);
+public:
+    explicit LayoutMinifier(Context* ctx) : Object(ctx) { }
+
+    /// Minify `layout` in place. `style_file` may be null, then only default values are removed.
+    void Minify(XMLFile* layout, XMLFile* style_file)
+    {
+        _removed = 0;
+        _bytes_before = layout->ToString().Length();
+        MinifyElement(layout->GetRoot(), style_file != nullptr ? style_file->GetRoot() : XMLElement());
+        _bytes_after = layout->ToString().Length();
+    }
+
+    /// Return number of attributes removed by last Minify().
+    unsigned GetRemovedAttributes() const { return _removed; }
+    unsigned GetBytesBefore() const { return _bytes_before; }
+    unsigned GetBytesAfter() const { return _bytes_after; }
+
+protected:
+    void MinifyElement(XMLElement element, const XMLElement& styles)
+    {
+        // Attributes of internal elements are applied on top of elements created and styled by their parent.
+        if (element.GetBool("internal"))
+            return;
+
+        auto type = element.GetAttribute("type");
+        if (type.Empty())
+            type = UIElement::GetTypeNameStatic();
+
+        if (auto attributes = context_->GetAttributes(StringHash(type)))
+        {
+            // Same style lookup UIElement does when loading layout.
+            auto style_name = element.GetAttribute("style");
+            if (style_name.Empty())
+                style_name = type;
+            XMLElement style;
+            if (styles.NotNull() && style_name != "none")
+                style = FindStyle(styles, style_name);
+
+            for (auto attribute = element.GetChild("attribute"); attribute.NotNull();)
+            {
+                auto next = attribute.GetNext("attribute");
+                if (IsRedundant(attribute, *attributes, styles, style))
+                {
+                    element.RemoveChild(attribute);
+                    _removed++;
+                }
+                attribute = next;
+            }
+        }
+
+        for (auto child = element.GetChild("element"); child.NotNull(); child = child.GetNext("element"))
+            MinifyElement(child, styles);
+    }
+
+    /// Return true if attribute value equals the value style would set, or attribute default when style does not set
+    /// it.
+    static bool IsRedundant(const XMLElement& attribute, const Vector<AttributeInfo>& attributes,
+                            const XMLElement& styles, const XMLElement& style)
+    {
+        auto name = attribute.GetAttribute("name");
+        for (const auto& info: attributes)
+        {
+            if (info.name_ != name)
+                continue;
+
+            auto style_attribute = FindStyleAttribute(styles, style, name);
+            auto inherited = style_attribute.NotNull() ? GetAttributeValue(style_attribute, info) : info.defaultValue_;
+            return GetAttributeValue(attribute, info) == inherited;
+        }
+        return false;
+    }
+
+    unsigned _removed = 0;
+    unsigned _bytes_before = 0;
+    unsigned _bytes_after = 0;
+};
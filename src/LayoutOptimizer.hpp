@@ -0,0 +1,146 @@
+#pragma once
+
+
+#include <Atomic/Container/Vector.h>
+
+#include <UrhoUI.h>
+
+#include "ElementUtils.hpp"
+#include "UndoManager.hpp"
+
+using namespace Atomic;
+using namespace Atomic::UrhoUI;
+
+
+/// Wrapper element removed by LayoutOptimizer.
+struct CollapsedWrapper
+{
+    /// Path of wrapper at the moment it was removed.
+    String path;
+    /// Number of children moved to parent of wrapper.
+    unsigned children;
+};
+
+/// Removes plain UIElement containers that only group their children. Children move to parent of the wrapper and
+/// keep their screen rects.
+class LayoutOptimizer
+{
+public:
+    /// Collapse redundant wrappers below `root`, root itself is kept. All changes are tracked in `undo` as a single
+    /// step.
+    void CollapseWrappers(UIElement* root, UndoManager& undo)
+    {
+        _collapsed.Clear();
+        _elements_before = CountElements(root);
+        _path_root = root->GetParent();
+
+        undo.BeginGroup();
+        for (const auto& child: Vector<SharedPtr<UIElement>>(root->GetChildren()))
+            CollapseTree(child, undo);
+        undo.EndGroup();
+
+        _elements_after = CountElements(root);
+    }
+
+    /// Return true if removing `element` and moving its children to its parent does not change what is displayed or
+    /// how it reacts to input and layout.
+    static bool IsRedundantWrapper(UIElement* element)
+    {
+        auto parent = element->GetParent();
+        if (parent == nullptr || element->GetType() != UIElement::GetTypeStatic() || element->IsInternal())
+            return false;
+
+        // Named elements and elements carrying data may be looked up by code.
+        if (!element->GetName().Empty() || !element->GetVars().Empty())
+            return false;
+
+        // Element that is positioned by layout of its parent or lays out its children has a layout role.
+        if (parent->GetLayoutMode() != LM_FREE || element->GetLayoutMode() != LM_FREE)
+            return false;
+
+        // Anything that affects children or input.
+        if (!element->IsVisible() || element->GetOpacity() != 1.0f || element->GetClipChildren() ||
+            element->IsEnabled() || element->GetFocusMode() != FM_NOTFOCUSABLE ||
+            element->GetDragDropMode() != DD_DISABLED || element->GetPriority() != 0)
+            return false;
+
+        // Aligned elements follow size of their parent, which would change.
+        if (!IsTopLeftAligned(element))
+            return false;
+
+        for (const auto& child: element->GetChildren())
+        {
+            if (child->IsInternal() || !IsTopLeftAligned(child))
+                return false;
+        }
+        return true;
+    }
+
+    const Vector<CollapsedWrapper>& GetCollapsed() const { return _collapsed; }
+    unsigned GetElementsBefore() const { return _elements_before; }
+    unsigned GetElementsAfter() const { return _elements_after; }
+
+    /// Return number of non-internal elements in tree of `element`, including itself.
+    static unsigned CountElements(UIElement* element)
+    {
+        if (element->IsInternal())
+            return 0;
+
+        unsigned count = 1;
+        for (const auto& child: element->GetChildren())
+            count += CountElements(child);
+        return count;
+    }
+
+protected:
+    static bool IsTopLeftAligned(UIElement* element)
+    {
+        return element->GetHorizontalAlignment() == HA_LEFT && element->GetVerticalAlignment() == VA_TOP;
+    }
+
+    void CollapseTree(UIElement* element, UndoManager& undo)
+    {
+        // Children first, nested wrappers collapse into their parent wrapper before it is checked.
+        for (const auto& child: Vector<SharedPtr<UIElement>>(element->GetChildren()))
+            CollapseTree(child, undo);
+
+        if (IsRedundantWrapper(element))
+            Collapse(element, undo);
+    }
+
+    void Collapse(UIElement* wrapper, UndoManager& undo)
+    {
+        static const String position_name("Position");
+
+        CollapsedWrapper collapsed;
+        collapsed.path = GetElementPath(wrapper, _path_root);
+        collapsed.children = wrapper->GetNumChildren();
+
+        SharedPtr<UIElement> wrapper_ref(wrapper);
+        auto parent = wrapper->GetParent();
+        auto index = parent->FindChild(wrapper);
+        auto parent_offset = parent->GetScreenPosition() + parent->GetChildOffset();
+        while (wrapper->GetNumChildren() > 0)
+        {
+            SharedPtr<UIElement> child(wrapper->GetChild(0u));
+            auto screen_position = child->GetScreenPosition();
+
+            undo.TrackValue(child, position_name, child->GetPosition());
+            undo.TrackRemoval(child);
+            parent->InsertChild(index++, child);
+            undo.TrackAddition(child);
+            child->SetPosition(screen_position - parent_offset);
+            undo.TrackValue(child, position_name, child->GetPosition());
+        }
+
+        undo.TrackRemoval(wrapper);
+        wrapper->Remove();
+        _collapsed.Push(collapsed);
+    }
+
+    Vector<CollapsedWrapper> _collapsed;
+    /// Element paths are relative to this element.
+    UIElement* _path_root = nullptr;
+    unsigned _elements_before = 0;
+    unsigned _elements_after = 0;
+};
@@ -0,0 +1,82 @@
+#pragma once
+
+
+#include <Atomic/Container/Vector.h>
+#include <Atomic/Core/Context.h>
+#include <Atomic/IO/File.h>
+#include <Atomic/IO/FileSystem.h>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace Atomic;
+
+
+/// Read-only view of a file. File is memory-mapped where mmap is available, elsewhere it is read into memory.
+class MappedFile
+{
+public:
+    ~MappedFile() { Close(); }
+
+    bool Open(Context* context, const String& file_path)
+    {
+        Close();
+#if !defined(_WIN32)
+        auto fd = open(GetNativePath(file_path).CString(), O_RDONLY);
+        if (fd < 0)
+            return false;
+
+        struct stat info;
+        if (fstat(fd, &info) == 0 && info.st_size > 0)
+        {
+            auto data = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+            if (data != MAP_FAILED)
+            {
+                _mapped = static_cast<unsigned char*>(data);
+                _size = static_cast<unsigned>(info.st_size);
+            }
+        }
+        // Mapping stays valid after descriptor is closed.
+        close(fd);
+        return _mapped != nullptr;
+#else
+        File file(context, file_path);
+        if (!file.IsOpen() || file.GetSize() == 0)
+            return false;
+        _buffer.Resize(file.GetSize());
+        _size = file.Read(&_buffer.Front(), _buffer.Size());
+        return _size == _buffer.Size();
+#endif
+    }
+
+    void Close()
+    {
+#if !defined(_WIN32)
+        if (_mapped != nullptr)
+            munmap(_mapped, _size);
+        _mapped = nullptr;
+#else
+        _buffer.Clear();
+#endif
+        _size = 0;
+    }
+
+#if !defined(_WIN32)
+    const unsigned char* GetData() const { return _mapped; }
+#else
+    const unsigned char* GetData() const { return _buffer.Empty() ? nullptr : &_buffer.Front(); }
+#endif
+    unsigned GetSize() const { return _size; }
+
+protected:
+#if !defined(_WIN32)
+    unsigned char* _mapped = nullptr;
+#else
+    PODVector<unsigned char> _buffer;
+#endif
+    unsigned _size = 0;
+};
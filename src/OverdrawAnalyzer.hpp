@@ -0,0 +1,230 @@
+#pragma once
+
+
+#include <Atomic/Container/Sort.h>
+#include <Atomic/Container/Vector.h>
+#include <Atomic/Math/Rect.h>
+
+#include <UrhoUI.h>
+
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#   include <emmintrin.h>
+#   define UIEDITOR_OVERDRAW_SSE2 1
+#endif
+
+using namespace Atomic;
+using namespace Atomic::UrhoUI;
+
+
+/// Area of the layout with high overdraw.
+struct OverdrawRegion
+{
+    IntRect rect;
+    /// Average number of elements covering a pixel of the region.
+    float average;
+    /// Highest number of elements covering a single pixel of the region.
+    unsigned max;
+};
+
+/// Counts how many visible elements cover each pixel of the root element. Works on element rectangles only, so no
+/// graphics device is required.
+class OverdrawAnalyzer
+{
+public:
+    /// Size of tiles used to find worst regions.
+    static const int REGION_SIZE = 64;
+    /// Maximal number of reported regions.
+    static const unsigned MAX_REGIONS = 8;
+    /// Size of heatmap cells.
+    static const int CELL_SIZE = 8;
+
+    void Analyze(UIElement* root)
+    {
+        _regions.Clear();
+        _sum = 0;
+        _covered = 0;
+        _max = 0;
+
+        auto pos = root->GetScreenPosition();
+        auto size = root->GetSize();
+        _origin = pos;
+        _width = Max(size.x_, 0);
+        _height = Max(size.y_, 0);
+        _counts.Resize(static_cast<unsigned>(_width * _height));
+        if (!_counts.Empty())
+            memset(&_counts.Front(), 0, _counts.Size() * sizeof(unsigned short));
+
+        if (root->IsVisible())
+        {
+            for (const auto& child: root->GetChildren())
+                CollectElement(child, IntRect(pos.x_, pos.y_, pos.x_ + size.x_, pos.y_ + size.y_));
+        }
+
+        for (auto count: _counts)
+        {
+            _sum += count;
+            _covered += count > 0;
+            _max = Max<unsigned>(_max, count);
+        }
+
+        FindRegions();
+        BuildHeatmap();
+    }
+
+    /// Return number of times pixels were drawn divided by number of pixels.
+    float GetOverdrawFactor() const { return _counts.Empty() ? 0.f : static_cast<float>(_sum) / _counts.Size(); }
+    /// Return average number of elements covering a pixel that is covered at all.
+    float GetAverageDepth() const { return _covered == 0 ? 0.f : static_cast<float>(_sum) / _covered; }
+    unsigned GetMaxCount() const { return _max; }
+    unsigned GetCoveredPixels() const { return _covered; }
+    int GetWidth() const { return _width; }
+    int GetHeight() const { return _height; }
+    /// Return screen position of analyzed area.
+    const IntVector2& GetOrigin() const { return _origin; }
+    /// Return regions sorted by average overdraw, worst first. Rectangles are in screen coordinates.
+    const PODVector<OverdrawRegion>& GetWorstRegions() const { return _regions; }
+    /// Return highest count in every heatmap cell, row by row.
+    const PODVector<unsigned char>& GetHeatmap() const { return _heatmap; }
+    int GetHeatmapWidth() const { return (_width + CELL_SIZE - 1) / CELL_SIZE; }
+    int GetHeatmapHeight() const { return (_height + CELL_SIZE - 1) / CELL_SIZE; }
+
+protected:
+    static IntRect Intersect(const IntRect& a, const IntRect& b)
+    {
+        IntRect result(Max(a.left_, b.left_), Max(a.top_, b.top_), Min(a.right_, b.right_), Min(a.bottom_, b.bottom_));
+        if (result.right_ < result.left_)
+            result.right_ = result.left_;
+        if (result.bottom_ < result.top_)
+            result.bottom_ = result.top_;
+        return result;
+    }
+
+    /// Return true if element produces pixels. Plain UIElement is only a container.
+    static bool IsDrawn(UIElement* element)
+    {
+        return element->GetType() != UIElement::GetTypeStatic() && element->GetDerivedOpacity() > 0.f;
+    }
+
+    void CollectElement(UIElement* element, const IntRect& clip)
+    {
+        if (!element->IsVisible())
+            return;
+
+        auto pos = element->GetScreenPosition();
+        auto size = element->GetSize();
+        IntRect rect(pos.x_, pos.y_, pos.x_ + size.x_, pos.y_ + size.y_);
+        if (IsDrawn(element))
+            AddRect(Intersect(rect, clip));
+
+        auto child_clip = clip;
+        if (element->GetClipChildren())
+        {
+            const auto& border = element->GetClipBorder();
+            child_clip = Intersect(clip, IntRect(rect.left_ + border.left_, rect.top_ + border.top_,
+                                                 rect.right_ - border.right_, rect.bottom_ - border.bottom_));
+        }
+
+        for (const auto& child: element->GetChildren())
+            CollectElement(child, child_clip);
+    }
+
+    /// Increment counts of all pixels in `rect` given in screen coordinates.
+    void AddRect(const IntRect& rect)
+    {
+        auto left = rect.left_ - _origin.x_;
+        auto right = rect.right_ - _origin.x_;
+        if (left >= right)
+            return;
+
+        for (auto y = rect.top_ - _origin.y_; y < rect.bottom_ - _origin.y_; y++)
+        {
+            auto row = &_counts[static_cast<unsigned>(y * _width)];
+            auto x = left;
+#if UIEDITOR_OVERDRAW_SSE2
+            // Eight saturating 16-bit increments at once.
+            const auto one = _mm_set1_epi16(1);
+            for (; x + 8 <= right; x += 8)
+            {
+                auto pixels = reinterpret_cast<__m128i*>(row + x);
+                _mm_storeu_si128(pixels, _mm_adds_epu16(_mm_loadu_si128(pixels), one));
+            }
+#endif
+            for (; x < right; x++)
+            {
+                if (row[x] != 0xFFFF)
+                    row[x]++;
+            }
+        }
+    }
+
+    void FindRegions()
+    {
+        for (auto top = 0; top < _height; top += REGION_SIZE)
+        {
+            for (auto left = 0; left < _width; left += REGION_SIZE)
+            {
+                auto right = Min(left + REGION_SIZE, _width);
+                auto bottom = Min(top + REGION_SIZE, _height);
+                unsigned long long sum = 0;
+                unsigned max = 0;
+                for (auto y = top; y < bottom; y++)
+                {
+                    for (auto x = left; x < right; x++)
+                    {
+                        auto count = _counts[static_cast<unsigned>(y * _width + x)];
+                        sum += count;
+                        max = Max<unsigned>(max, count);
+                    }
+                }
+
+                // Regions where every pixel is drawn at most once have no overdraw.
+                if (max < 2)
+                    continue;
+
+                OverdrawRegion region;
+                region.rect = IntRect(left + _origin.x_, top + _origin.y_, right + _origin.x_, bottom + _origin.y_);
+                region.average = static_cast<float>(sum) / ((right - left) * (bottom - top));
+                region.max = max;
+                _regions.Push(region);
+            }
+        }
+
+        Sort(_regions.Begin(), _regions.End(), [](const OverdrawRegion& a, const OverdrawRegion& b) {
+            return a.average > b.average;
+        });
+        if (_regions.Size() > MAX_REGIONS)
+            _regions.Resize(MAX_REGIONS);
+    }
+
+    void BuildHeatmap()
+    {
+        auto heatmap_width = GetHeatmapWidth();
+        _heatmap.Resize(static_cast<unsigned>(heatmap_width * GetHeatmapHeight()));
+        if (_heatmap.Empty())
+            return;
+
+        memset(&_heatmap.Front(), 0, _heatmap.Size());
+        for (auto y = 0; y < _height; y++)
+        {
+            auto cells = &_heatmap[static_cast<unsigned>(y / CELL_SIZE * heatmap_width)];
+            auto row = &_counts[static_cast<unsigned>(y * _width)];
+            for (auto x = 0; x < _width; x++)
+            {
+                auto& cell = cells[x / CELL_SIZE];
+                cell = static_cast<unsigned char>(Max<unsigned>(cell, Min<unsigned>(row[x], 255)));
+            }
+        }
+    }
+
+    PODVector<unsigned short> _counts;
+    PODVector<unsigned char> _heatmap;
+    PODVector<OverdrawRegion> _regions;
+    IntVector2 _origin;
+    int _width = 0;
+    int _height = 0;
+    unsigned long long _sum = 0;
+    unsigned _covered = 0;
+    unsigned _max = 0;
+};
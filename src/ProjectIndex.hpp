@@ -0,0 +1,401 @@
+#pragma once
+
+
+#include <Atomic/Container/HashMap.h>
+#include <Atomic/Container/Sort.h>
+#include <Atomic/Core/Context.h>
+#include <Atomic/Core/Object.h>
+#include <Atomic/Core/WorkQueue.h>
+#include <Atomic/IO/File.h>
+#include <Atomic/IO/FileSystem.h>
+#include <Atomic/IO/MemoryBuffer.h>
+#include <Atomic/Resource/XMLFile.h>
+
+#include <UrhoUI.h>
+
+#include <cctype>
+
+#include "MappedFile.hpp"
+#include "TraceRecorder.hpp"
+
+using namespace Atomic;
+using namespace Atomic::UrhoUI;
+
+
+enum ProjectFileKind
+{
+    PROJECT_FILE_OTHER = 0,
+    PROJECT_FILE_LAYOUT,
+    PROJECT_FILE_STYLE,
+};
+
+enum ProjectIndexQuery
+{
+    QUERY_TYPE = 0,
+    QUERY_STYLE,
+    QUERY_RESOURCE,
+};
+
+/// Indexed contents of a single XML file.
+struct ProjectIndexEntry
+{
+    /// Path relative to index root.
+    String path;
+    unsigned modified = 0;
+    unsigned checksum = 0;
+    ProjectFileKind kind = PROJECT_FILE_OTHER;
+    /// Element types of layout, or style names defined by style sheet.
+    StringVector types;
+    /// Styles layout elements use, or base styles and internal element styles style sheet refers to.
+    StringVector styles;
+    Vector<ResourceRef> resources;
+};
+
+/// Index of layouts and style sheets under a root directory, persisted in a binary file. Update() only parses files
+/// whose modification time and contents changed since the index was saved. Queries use inverted maps from type, style
+/// and resource name to files, built when entries change.
+class ProjectIndex : public Object
+{
+    ATOMIC_OBJECT(ProjectIndex, Object);
+public:
+    /// Increment when format of index file changes.
+    static const unsigned VERSION = 1;
+
+    explicit ProjectIndex(Context* ctx) : Object(ctx) { }
+
+    /// Load index saved by Save(). Return false when file does not exist or was written by different version.
+    bool Load(const String& file_path)
+    {
+        Clear();
+        MappedFile mapped;
+        if (!mapped.Open(context_, file_path))
+            return false;
+
+        MemoryBuffer buffer(mapped.GetData(), mapped.GetSize());
+        if (buffer.ReadFileID() != "UIIX" || buffer.ReadUInt() != VERSION)
+            return false;
+
+        _root = buffer.ReadString();
+        auto count = buffer.ReadVLE();
+        for (unsigned i = 0; i < count && !buffer.IsEof(); i++)
+        {
+            ProjectIndexEntry entry;
+            entry.path = buffer.ReadString();
+            entry.modified = buffer.ReadUInt();
+            entry.checksum = buffer.ReadUInt();
+            entry.kind = static_cast<ProjectFileKind>(buffer.ReadUByte());
+            entry.types = buffer.ReadStringVector();
+            entry.styles = buffer.ReadStringVector();
+            entry.resources.Resize(buffer.ReadVLE());
+            for (auto& ref: entry.resources)
+                ref = buffer.ReadResourceRef();
+            _entries[entry.path] = entry;
+        }
+
+        if (_entries.Size() != count)
+        {
+            // Truncated index, parse everything again.
+            Clear();
+            return false;
+        }
+        BuildLookup();
+        return true;
+    }
+
+    bool Save(const String& file_path) const
+    {
+        File file(context_, file_path, FILE_WRITE);
+        if (!file.IsOpen())
+            return false;
+
+        file.WriteFileID("UIIX");
+        file.WriteUInt(VERSION);
+        file.WriteString(_root);
+        file.WriteVLE(_entries.Size());
+        for (const auto& it: _entries)
+        {
+            const auto& entry = it.second_;
+            file.WriteString(entry.path);
+            file.WriteUInt(entry.modified);
+            file.WriteUInt(entry.checksum);
+            file.WriteUByte(static_cast<unsigned char>(entry.kind));
+            file.WriteStringVector(entry.types);
+            file.WriteStringVector(entry.styles);
+            file.WriteVLE(entry.resources.Size());
+            for (const auto& ref: entry.resources)
+                file.WriteResourceRef(ref);
+        }
+        return true;
+    }
+
+    void Clear()
+    {
+        _root.Clear();
+        _entries.Clear();
+        for (auto& lookup: _lookup)
+            lookup.Clear();
+    }
+
+    /// Bring index up to date with XML files under `root`. Return true if any entry changed.
+    bool Update(const String& root)
+    {
+        auto fs = GetSubsystem<FileSystem>();
+        auto normalized_root = AddTrailingSlash(root);
+        if (normalized_root != _root)
+        {
+            Clear();
+            _root = normalized_root;
+        }
+
+        Vector<String> files;
+        fs->ScanDir(files, _root, "*.xml", SCAN_FILES, true);
+
+        // Files with unchanged modification time are not touched at all, other files are hashed and parsed on work
+        // queue.
+        Vector<IndexJob> jobs;
+        HashMap<String, ProjectIndexEntry> entries;
+        for (const auto& path: files)
+        {
+            auto modified = fs->GetLastModifiedTime(_root + path);
+            auto it = _entries.Find(path);
+            if (it != _entries.End() && it->second_.modified == modified)
+            {
+                entries[path] = it->second_;
+                continue;
+            }
+
+            IndexJob job;
+            job.context = context_;
+            job.full_path = _root + path;
+            job.entry.path = path;
+            job.entry.modified = modified;
+            if (it != _entries.End())
+            {
+                job.has_previous = true;
+                job.previous_checksum = it->second_.checksum;
+            }
+            jobs.Push(job);
+        }
+
+        auto queue = GetSubsystem<WorkQueue>();
+        for (auto& job: jobs)
+        {
+            SharedPtr<WorkItem> item = queue->GetFreeItem();
+            item->priority_ = M_MAX_UNSIGNED;
+            item->workFunction_ = IndexFileWork;
+            item->start_ = &job;
+            queue->AddWorkItem(item);
+        }
+        queue->Complete(M_MAX_UNSIGNED);
+
+        _num_parsed = 0;
+        _num_failed = 0;
+        for (auto& job: jobs)
+        {
+            if (job.same_content)
+            {
+                // Only modification time changed.
+                auto& entry = entries[job.entry.path];
+                entry = _entries[job.entry.path];
+                entry.modified = job.entry.modified;
+                continue;
+            }
+            // Failed files are not indexed, so next update tries them again.
+            if (!job.loaded)
+            {
+                _num_failed++;
+                continue;
+            }
+            _num_parsed++;
+            entries[job.entry.path] = job.entry;
+        }
+
+        _num_removed = 0;
+        for (const auto& it: _entries)
+        {
+            if (!entries.Contains(it.first_))
+                _num_removed++;
+        }
+        _num_reused = entries.Size() - _num_parsed;
+
+        _entries = entries;
+        BuildLookup();
+        return !jobs.Empty() || _num_removed > 0;
+    }
+
+    /// Return sorted paths, relative to root, of files whose types, styles or resources contain `value`. Resource
+    /// names are compared without regard to case.
+    const Vector<String>& Query(ProjectIndexQuery query, const String& value) const
+    {
+        static const Vector<String> empty;
+        const auto& lookup = _lookup[query];
+        auto it = lookup.Find(query == QUERY_RESOURCE ? value.ToLower() : value);
+        return it != lookup.End() ? it->second_ : empty;
+    }
+
+    /// Return root directory with trailing slash.
+    const String& GetRoot() const { return _root; }
+    const HashMap<String, ProjectIndexEntry>& GetEntries() const { return _entries; }
+    /// Return number of files parsed by last Update().
+    unsigned GetNumParsed() const { return _num_parsed; }
+    /// Return number of files last Update() took from index without parsing.
+    unsigned GetNumReused() const { return _num_reused; }
+    unsigned GetNumRemoved() const { return _num_removed; }
+    /// Return number of files last Update() could not parse. They are left out of index and parsed by next Update().
+    unsigned GetNumFailed() const { return _num_failed; }
+
+protected:
+    struct IndexJob
+    {
+        Context* context = nullptr;
+        String full_path;
+        ProjectIndexEntry entry;
+        bool has_previous = false;
+        unsigned previous_checksum = 0;
+        bool same_content = false;
+        bool loaded = false;
+    };
+
+    static void IndexFileWork(const WorkItem* item, unsigned)
+    {
+        auto& job = *static_cast<IndexJob*>(item->start_);
+        TraceZone trace_zone(job.context->GetSubsystem<TraceRecorder>(), "ProjectIndex::IndexFile", "worker");
+        File file(job.context, job.full_path);
+        if (!file.IsOpen())
+            return;
+
+        job.entry.checksum = file.GetChecksum();
+        if (job.has_previous && job.entry.checksum == job.previous_checksum)
+        {
+            job.same_content = true;
+            return;
+        }
+
+        file.Seek(0);
+        XMLFile xml(job.context);
+        job.loaded = xml.Load(file);
+        if (!job.loaded)
+            return;
+
+        auto root = xml.GetRoot();
+        if (root.GetName() == "element")
+        {
+            job.entry.kind = PROJECT_FILE_LAYOUT;
+            IndexLayoutElement(root, job.entry);
+        }
+        else if (root.GetName() == "elements")
+        {
+            job.entry.kind = PROJECT_FILE_STYLE;
+            for (auto style = root.GetChild("element"); style.NotNull(); style = style.GetNext("element"))
+            {
+                AddUnique(job.entry.types, style.GetAttribute("type"));
+                AddUnique(job.entry.styles, style.GetAttribute("style"));
+                IndexStyleElement(style, job.entry);
+            }
+        }
+    }
+
+    /// Build inverted maps used by Query() from entries.
+    void BuildLookup()
+    {
+        for (auto& lookup: _lookup)
+            lookup.Clear();
+        for (const auto& it: _entries)
+        {
+            const auto& entry = it.second_;
+            for (const auto& type: entry.types)
+                _lookup[QUERY_TYPE][type].Push(entry.path);
+            for (const auto& style: entry.styles)
+                _lookup[QUERY_STYLE][style].Push(entry.path);
+            // Same resource may be referenced with names that differ in case or by different resource types.
+            StringVector names;
+            for (const auto& ref: entry.resources)
+                AddUnique(names, ref.name_.ToLower());
+            for (const auto& name: names)
+                _lookup[QUERY_RESOURCE][name].Push(entry.path);
+        }
+        for (auto& lookup: _lookup)
+        {
+            for (auto& it: lookup)
+                Sort(it.second_.Begin(), it.second_.End());
+        }
+    }
+
+    static void IndexLayoutElement(const XMLElement& element, ProjectIndexEntry& entry)
+    {
+        auto type = element.GetAttribute("type");
+        if (type.Empty())
+            type = UIElement::GetTypeNameStatic();
+        AddUnique(entry.types, type);
+
+        auto style = element.GetAttribute("style");
+        if (style.Empty() && !element.GetBool("internal"))
+            style = type;
+        if (style != "none")
+            AddUnique(entry.styles, style);
+
+        IndexAttributes(element, entry);
+        for (auto child = element.GetChild("element"); child.NotNull(); child = child.GetNext("element"))
+            IndexLayoutElement(child, entry);
+    }
+
+    static void IndexStyleElement(const XMLElement& element, ProjectIndexEntry& entry)
+    {
+        IndexAttributes(element, entry);
+        for (auto child = element.GetChild("element"); child.NotNull(); child = child.GetNext("element"))
+        {
+            auto style = child.GetAttribute("style");
+            if (style != "none")
+                AddUnique(entry.styles, style);
+            IndexStyleElement(child, entry);
+        }
+    }
+
+    /// Collect attribute values that look like serialized ResourceRef or ResourceRefList ("Type;name[;name...]").
+    /// Attribute types are not known without instantiating elements, so value format decides.
+    static void IndexAttributes(const XMLElement& element, ProjectIndexEntry& entry)
+    {
+        for (auto attribute = element.GetChild("attribute"); attribute.NotNull();
+             attribute = attribute.GetNext("attribute"))
+        {
+            auto value = attribute.GetAttribute("value");
+            auto separator = value.Find(';');
+            if (separator == 0 || separator == String::NPOS || !IsIdentifier(value.Substring(0, separator)))
+                continue;
+
+            auto parts = value.Split(';');
+            StringHash type(parts[0]);
+            for (unsigned i = 1; i < parts.Size(); i++)
+            {
+                ResourceRef ref(type, parts[i]);
+                if (!entry.resources.Contains(ref))
+                    entry.resources.Push(ref);
+            }
+        }
+    }
+
+    static bool IsIdentifier(const String& value)
+    {
+        for (auto c: value)
+        {
+            if (!isalnum(static_cast<unsigned char>(c)) && c != '_')
+                return false;
+        }
+        return true;
+    }
+
+    static void AddUnique(StringVector& values, const String& value)
+    {
+        if (!value.Empty() && !values.Contains(value))
+            values.Push(value);
+    }
+
+    String _root;
+    HashMap<String, ProjectIndexEntry> _entries;
+    /// Query kind -> type, style or lowercase resource name -> sorted paths of files using it.
+    HashMap<String, Vector<String>> _lookup[QUERY_RESOURCE + 1];
+    unsigned _num_parsed = 0;
+    unsigned _num_reused = 0;
+    unsigned _num_removed = 0;
+    unsigned _num_failed = 0;
+};
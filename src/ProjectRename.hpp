@@ -0,0 +1,276 @@
+#pragma once
+
+
+#include <Atomic/Core/Context.h>
+#include <Atomic/Core/Object.h>
+#include <Atomic/Core/Timer.h>
+#include <Atomic/Core/WorkQueue.h>
+#include <Atomic/IO/File.h>
+
+#include <UrhoUI.h>
+
+#include <atomic>
+
+#include "TraceRecorder.hpp"
+#include "XMLRewriter.hpp"
+
+using namespace Atomic;
+using namespace Atomic::UrhoUI;
+
+
+enum RenameKind
+{
+    RENAME_STYLE = 0,
+    RENAME_RESOURCE,
+};
+
+/// Result of renaming in a single file.
+struct RenameFileResult
+{
+    String file_path;
+    /// Number of usages found, or replaced when renaming.
+    unsigned usages = 0;
+    bool success = false;
+    String error;
+};
+
+/// Finds usages of a style or resource in XML files and renames them. Every file is rewritten by a single streaming
+/// pass on the work queue, files are not loaded into DOM.
+class ProjectRename : public Object
+{
+    ATOMIC_OBJECT(ProjectRename, Object);
+public:
+    explicit ProjectRename(Context* ctx) : Object(ctx) { }
+
+    /// Start renaming `from` to `to` in `files`. Empty `to` only counts usages. With `dry_run` files are not written.
+    /// Progress is available while work items run, call Wait() or poll IsFinished().
+    bool Start(RenameKind kind, const String& from, const String& to, const Vector<String>& files, bool dry_run)
+    {
+        if (IsRunning() || from.Empty())
+            return false;
+
+        _kind = kind;
+        _from = from;
+        _to = to;
+        _dry_run = dry_run || to.Empty();
+        _num_done = 0;
+        _finished = false;
+        _results.Clear();
+        _results.Resize(files.Size());
+        for (unsigned i = 0; i < files.Size(); i++)
+            _results[i].file_path = files[i];
+
+        _timer.Reset();
+        auto queue = GetSubsystem<WorkQueue>();
+        for (auto& result: _results)
+        {
+            SharedPtr<WorkItem> item = queue->GetFreeItem();
+            item->priority_ = M_MAX_UNSIGNED;
+            item->workFunction_ = RenameWork;
+            item->aux_ = this;
+            item->start_ = &result;
+            queue->AddWorkItem(item);
+        }
+
+        // Without worker threads nothing runs until main thread completes the queue.
+        if (queue->GetNumThreads() == 0)
+            Wait();
+        return true;
+    }
+
+    /// Block until all files are processed.
+    void Wait()
+    {
+        GetSubsystem<WorkQueue>()->Complete(M_MAX_UNSIGNED);
+        IsFinished();
+    }
+
+    /// Return true when all files are processed. Elapsed time is recorded by the first call that sees it.
+    bool IsFinished()
+    {
+        if (!_finished && _num_done == _results.Size())
+        {
+            _elapsed_ms = _timer.GetUSec(false) / 1000.0f;
+            _finished = true;
+        }
+        return _finished;
+    }
+
+    bool IsRunning() const { return !_results.Empty() && _num_done < _results.Size(); }
+    unsigned GetNumDone() const { return _num_done; }
+    unsigned GetNumFiles() const { return _results.Size(); }
+    /// Return milliseconds since Start(), final time once finished.
+    float GetElapsedMs() const { return _finished ? _elapsed_ms : _timer.GetUSec(false) / 1000.0f; }
+    RenameKind GetKind() const { return _kind; }
+    const String& GetFrom() const { return _from; }
+    const String& GetTo() const { return _to; }
+    bool IsDryRun() const { return _dry_run; }
+    /// Return per file results, valid once finished.
+    const Vector<RenameFileResult>& GetResults() const { return _results; }
+
+    unsigned GetTotalUsages() const
+    {
+        unsigned total = 0;
+        for (const auto& result: _results)
+            total += result.usages;
+        return total;
+    }
+
+    /// Rename style `from` to `to` in XML text. Layout elements that got style `from` implicitly from their type get
+    /// explicit style attribute. Return number of changes.
+    static unsigned RenameStyle(const String& input, String& output, const String& from, const String& to)
+    {
+        String root;
+        return RewriteXMLAttributes(input, output, [&](const String& tag, unsigned depth,
+                                                       Vector<XMLTagAttribute>& attributes) -> unsigned
+        {
+            if (depth == 0)
+                root = tag;
+            if (tag != "element")
+                return 0;
+
+            XMLTagAttribute* style = nullptr;
+            XMLTagAttribute* type = nullptr;
+            auto internal = false;
+            for (auto& attribute: attributes)
+            {
+                if (attribute.name == "style")
+                    style = &attribute;
+                else if (attribute.name == "type")
+                    type = &attribute;
+                else if (attribute.name == "internal")
+                    internal = ToBool(attribute.value);
+            }
+
+            unsigned changes = 0;
+            if (style != nullptr && style->value == from)
+            {
+                style->value = to;
+                style->changed = true;
+                changes++;
+            }
+
+            if (root == "elements" && depth == 1)
+            {
+                // Style definition.
+                if (type != nullptr && type->value == from)
+                {
+                    type->value = to;
+                    type->changed = true;
+                    changes++;
+                }
+            }
+            else if (root == "element" && style == nullptr && !internal)
+            {
+                auto type_name = type != nullptr ? type->value : UIElement::GetTypeNameStatic();
+                if (type_name == from)
+                {
+                    XMLTagAttribute added;
+                    added.name = "style";
+                    added.value = to;
+                    added.changed = true;
+                    attributes.Push(added);
+                    changes++;
+                }
+            }
+            return changes;
+        });
+    }
+
+    /// Rename resource `from` to `to` in serialized ResourceRef and ResourceRefList attribute values. Resource names
+    /// are compared without regard to case. Return number of changes.
+    static unsigned RenameResource(const String& input, String& output, const String& from, const String& to)
+    {
+        return RewriteXMLAttributes(input, output, [&](const String& tag, unsigned,
+                                                       Vector<XMLTagAttribute>& attributes) -> unsigned
+        {
+            if (tag != "attribute")
+                return 0;
+
+            unsigned changes = 0;
+            for (auto& attribute: attributes)
+            {
+                if (attribute.name != "value" || !attribute.value.Contains(';'))
+                    continue;
+
+                auto parts = attribute.value.Split(';');
+                auto renamed = false;
+                for (unsigned i = 1; i < parts.Size(); i++)
+                {
+                    if (parts[i].Compare(from, false) == 0)
+                    {
+                        parts[i] = to;
+                        renamed = true;
+                        changes++;
+                    }
+                }
+                if (renamed)
+                {
+                    attribute.value.Join(parts, ";");
+                    attribute.changed = true;
+                }
+            }
+            return changes;
+        });
+    }
+
+protected:
+    static void RenameWork(const WorkItem* item, unsigned)
+    {
+        auto self = static_cast<ProjectRename*>(item->aux_);
+        auto& result = *static_cast<RenameFileResult*>(item->start_);
+        {
+            TraceZone trace_zone(self->GetSubsystem<TraceRecorder>(), "ProjectRename::RenameFile", "worker");
+            self->RenameFile(result);
+        }
+        self->_num_done++;
+    }
+
+    void RenameFile(RenameFileResult& result)
+    {
+        String input;
+        {
+            File file(context_, result.file_path);
+            if (!file.IsOpen())
+            {
+                result.error = "Opening file failed.";
+                return;
+            }
+            input.Resize(file.GetSize());
+            if (file.GetSize() > 0 && file.Read(&input[0], file.GetSize()) != file.GetSize())
+            {
+                result.error = "Reading file failed.";
+                return;
+            }
+        }
+
+        String output;
+        // Finding usages is renaming to the same name.
+        const auto& to = _to.Empty() ? _from : _to;
+        if (_kind == RENAME_STYLE)
+            result.usages = RenameStyle(input, output, _from, to);
+        else
+            result.usages = RenameResource(input, output, _from, to);
+
+        if (!_dry_run && result.usages > 0)
+        {
+            File file(context_, result.file_path, FILE_WRITE);
+            if (!file.IsOpen() || file.Write(output.CString(), output.Length()) != output.Length())
+            {
+                result.error = "Writing file failed.";
+                return;
+            }
+        }
+        result.success = true;
+    }
+
+    RenameKind _kind = RENAME_STYLE;
+    String _from;
+    String _to;
+    bool _dry_run = true;
+    Vector<RenameFileResult> _results;
+    std::atomic<unsigned> _num_done{0};
+    bool _finished = false;
+    mutable HiresTimer _timer;
+    float _elapsed_ms = 0;
+};
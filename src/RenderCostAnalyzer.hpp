@@ -0,0 +1,211 @@
+#pragma once
+
+
+#include <Atomic/Container/HashMap.h>
+#include <Atomic/Container/HashSet.h>
+#include <Atomic/Container/Vector.h>
+
+#include <UrhoUI.h>
+
+using namespace Atomic;
+using namespace Atomic::UrhoUI;
+
+
+/// Rendering cost caused by UI elements.
+struct RenderCost
+{
+    /// Batches that could not be merged with previous batch. Each one is a separate draw call.
+    unsigned draw_calls = 0;
+    unsigned vertices = 0;
+    /// Draw calls started because texture differs from previous batch.
+    unsigned texture_switches = 0;
+    /// Draw calls started because blend mode differs from previous batch. Batches of this UI have no materials,
+    /// blend mode is the only other render state.
+    unsigned blend_switches = 0;
+    /// Draw calls started because clipping rectangle differs from previous batch.
+    unsigned scissor_breaks = 0;
+
+    RenderCost& operator+=(const RenderCost& other)
+    {
+        draw_calls += other.draw_calls;
+        vertices += other.vertices;
+        texture_switches += other.texture_switches;
+        blend_switches += other.blend_switches;
+        scissor_breaks += other.scissor_breaks;
+        return *this;
+    }
+
+    /// Return true when element forced a render state change.
+    bool BreaksBatching() const { return texture_switches + blend_switches + scissor_breaks > 0; }
+};
+
+struct ElementRenderCost
+{
+    WeakPtr<UIElement> element;
+    /// Depth of element relative to analyzed root.
+    unsigned depth = 0;
+    /// Index of parent in analyzer element list or M_MAX_UNSIGNED for root.
+    unsigned parent = M_MAX_UNSIGNED;
+    /// Cost of batches generated by element itself.
+    RenderCost own;
+    /// Cost of element and all of its descendants.
+    RenderCost subtree;
+};
+
+/// Collects batches UI would generate for a tree of elements and attributes draw calls and render state changes to
+/// elements that caused them.
+class RenderCostAnalyzer
+{
+public:
+    /// Analyze elements below `root`. `cursor` is skipped like UI does when rendering.
+    void Analyze(UIElement* root, UIElement* cursor = nullptr)
+    {
+        _elements.Clear();
+        _index.Clear();
+        _batches.Clear();
+        _vertex_data.Clear();
+        _total = RenderCost();
+        _cursor = cursor;
+
+        if (root == nullptr)
+            return;
+
+        AddElement(root, 0, M_MAX_UNSIGNED);
+
+        // Root draws nothing itself, UI starts from its children clipped by root rect.
+        const auto& pos = root->GetPosition();
+        const auto& size = root->GetSize();
+        if (root->IsVisible())
+            CollectBatches(root, IntRect(pos.x_, pos.y_, pos.x_ + size.x_, pos.y_ + size.y_));
+
+        // Children always follow their parents in element list.
+        for (unsigned i = _elements.Size(); i-- > 0;)
+        {
+            auto& cost = _elements[i];
+            cost.subtree += cost.own;
+            _total += cost.own;
+            if (cost.parent != M_MAX_UNSIGNED)
+                _elements[cost.parent].subtree += cost.subtree;
+        }
+    }
+
+    /// Return analyzed elements in depth-first order.
+    const Vector<ElementRenderCost>& GetElements() const { return _elements; }
+
+    const RenderCost& GetTotal() const { return _total; }
+
+    /// Return number of distinct textures batches of analyzed elements use.
+    unsigned GetNumTextures() const
+    {
+        HashSet<Texture*> textures;
+        for (const auto& batch: _batches)
+        {
+            if (batch.texture_ != nullptr)
+                textures.Insert(batch.texture_);
+        }
+        return textures.Size();
+    }
+
+    /// Return cost of element or null if element was not analyzed.
+    const ElementRenderCost* GetCost(UIElement* element) const
+    {
+        auto it = _index.Find(element);
+        if (it == _index.End())
+            return nullptr;
+        return &_elements[it->second_];
+    }
+
+protected:
+    void AddElement(UIElement* element, unsigned depth, unsigned parent)
+    {
+        auto index = _elements.Size();
+        _elements.Resize(index + 1);
+        _elements[index].element = element;
+        _elements[index].depth = depth;
+        _elements[index].parent = parent;
+        _index[element] = index;
+
+        for (const auto& child: element->GetChildren())
+            AddElement(child, depth + 1, index);
+    }
+
+    /// Mirrors UI::GetBatches() traversal.
+    void CollectBatches(UIElement* element, IntRect scissor)
+    {
+        element->AdjustScissor(scissor);
+        if (scissor.left_ == scissor.right_ || scissor.top_ == scissor.bottom_)
+            return;
+
+        element->SortChildren();
+        const auto& children = element->GetChildren();
+        auto i = children.Begin();
+        if (element->GetTraversalMode() == TM_BREADTH_FIRST)
+        {
+            // Siblings of same priority draw first, then their children.
+            auto j = i;
+            while (i != children.End())
+            {
+                auto priority = (*i)->GetPriority();
+                for (; j != children.End() && (*j)->GetPriority() == priority; ++j)
+                {
+                    if ((*j)->IsWithinScissor(scissor) && *j != _cursor)
+                        AddElementBatches(*j, scissor);
+                }
+                for (; i != j; ++i)
+                {
+                    if ((*i)->IsVisible() && *i != _cursor)
+                        CollectBatches(*i, scissor);
+                }
+            }
+        }
+        else
+        {
+            for (; i != children.End(); ++i)
+            {
+                if (*i == _cursor)
+                    continue;
+                if ((*i)->IsWithinScissor(scissor))
+                    AddElementBatches(*i, scissor);
+                if ((*i)->IsVisible())
+                    CollectBatches(*i, scissor);
+            }
+        }
+    }
+
+    void AddElementBatches(UIElement* element, const IntRect& scissor)
+    {
+        auto first_batch = _batches.Size();
+        auto first_vertex = _vertex_data.Size();
+        element->GetBatches(_batches, _vertex_data, scissor);
+
+        auto it = _index.Find(element);
+        if (it == _index.End())
+            return;
+
+        auto& cost = _elements[it->second_].own;
+        cost.vertices += (_vertex_data.Size() - first_vertex) / UI_VERTEX_SIZE;
+        // Batches merged into a previous batch do not show up as new ones.
+        for (auto i = first_batch; i < _batches.Size(); i++)
+        {
+            cost.draw_calls++;
+            if (i == 0)
+                continue;
+
+            const auto& previous = _batches[i - 1];
+            const auto& batch = _batches[i];
+            if (previous.texture_ != batch.texture_)
+                cost.texture_switches++;
+            if (previous.blendMode_ != batch.blendMode_)
+                cost.blend_switches++;
+            if (previous.scissor_ != batch.scissor_)
+                cost.scissor_breaks++;
+        }
+    }
+
+    Vector<ElementRenderCost> _elements;
+    HashMap<UIElement*, unsigned> _index;
+    PODVector<UIBatch> _batches;
+    PODVector<float> _vertex_data;
+    RenderCost _total;
+    UIElement* _cursor = nullptr;
+};
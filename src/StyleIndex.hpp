@@ -0,0 +1,316 @@
+#pragma once
+
+
+#include <Atomic/Container/HashMap.h>
+#include <Atomic/Container/HashSet.h>
+#include <Atomic/Core/Object.h>
+#include <Atomic/Resource/XMLFile.h>
+
+#include <UrhoUI.h>
+
+#include "ElementUtils.hpp"
+#include "FrameProfiler.hpp"
+#include "TraceRecorder.hpp"
+
+using namespace Atomic;
+using namespace Atomic::UrhoUI;
+
+
+/// Reverse index from style name to live elements whose applied style is that style or is based on it. Index follows
+/// elements added to and removed from the tree under root, so a style change restyles only elements that use it.
+/// Changed style attributes are collected during a frame and applied in one batch by ApplyPendingRestyle(). Only the
+/// changed attributes are set, and only on elements that still have the value style gave them, so values elements
+/// override are kept.
+class StyleIndex : public Object
+{
+    ATOMIC_OBJECT(StyleIndex, Object);
+public:
+    explicit StyleIndex(Context* ctx) : Object(ctx) { }
+
+    /// Start indexing elements under `root`.
+    void SetRoot(UIElement* root)
+    {
+        if (_root.NotNull())
+            UnsubscribeFromAllEvents();
+        Clear();
+        _root = root;
+        if (_root.Null())
+            return;
+
+        using namespace std::placeholders;
+        SubscribeToEvent(_root, E_ELEMENTADDED, std::bind(&StyleIndex::OnElementAdded, this, _2));
+        SubscribeToEvent(_root, E_ELEMENTREMOVED, std::bind(&StyleIndex::OnElementRemoved, this, _2));
+        for (const auto& child: _root->GetChildren())
+            _pending.Push(WeakPtr<UIElement>(child));
+    }
+
+    /// Set style file base style chains are read from. Elements are indexed again, style chains may differ.
+    void SetStyleFile(XMLFile* style_file)
+    {
+        _style_file = style_file;
+        Clear();
+        if (_root.NotNull())
+        {
+            for (const auto& child: _root->GetChildren())
+                _pending.Push(WeakPtr<UIElement>(child));
+        }
+    }
+
+    /// Mark attribute `name` of style element `style` as changed from `old_value`, which is empty when attribute was
+    /// not set. Elements using the style or styles based on it are updated by next ApplyPendingRestyle().
+    void InvalidateStyle(const XMLElement& style, const String& name, const Variant& old_value)
+    {
+        InvalidateStyle(StyleAttributeChange{style, name, old_value});
+    }
+
+    void InvalidateStyle(const StyleAttributeChange& change)
+    {
+        if (change.style.IsNull())
+            return;
+        // Value before the first change of a frame is what elements got from style.
+        for (const auto& pending: _changes)
+        {
+            if (pending.style.GetNode() == change.style.GetNode() && pending.name == change.name)
+                return;
+        }
+        _changes.Push(change);
+    }
+
+    /// Index elements added since last call and apply style attributes changed since last call. Return number of
+    /// restyled elements.
+    unsigned ApplyPendingRestyle()
+    {
+        if (_pending.Empty() && _changes.Empty())
+            return 0;
+
+        TraceZone trace_zone(GetSubsystem<TraceRecorder>(), "StyleIndex::ApplyPendingRestyle", "edit");
+        IndexPending();
+
+        HashSet<UIElement*> restyled;
+        for (const auto& change: _changes)
+        {
+            // Nested style of an internal element applies to internal descendants of elements using top level style.
+            Vector<XMLElement> nesting;
+            auto top_style = change.style;
+            while (top_style.GetParent().NotNull() && top_style.GetParent().GetName() == "element")
+            {
+                nesting.Insert(0, top_style);
+                top_style = top_style.GetParent();
+            }
+
+            auto it = _elements.Find(top_style.GetAttribute("type"));
+            if (it == _elements.End())
+                continue;
+            for (auto element: it->second_)
+            {
+                auto target = FindInternalElement(element, top_style, nesting);
+                if (target != nullptr && RestyleAttribute(target, element, change, !nesting.Empty()))
+                    restyled.Insert(target);
+            }
+        }
+        _changes.Clear();
+
+        for (auto element: restyled)
+            element->ApplyAttributes();
+
+        if (auto profiler = GetSubsystem<FrameProfiler>())
+            profiler->Count(FrameProfiler::COUNTER_RESTYLES, restyled.Size());
+        return restyled.Size();
+    }
+
+    /// Index `element` again, needed when its applied style was changed. Children are not affected.
+    void UpdateElement(UIElement* element)
+    {
+        RemoveElement(element);
+        // Internal elements get their style from style of their parent.
+        if (element->IsInternal())
+            return;
+
+        const auto& chain = GetStyleChain(element->GetAppliedStyle().Empty() ? element->GetTypeName() :
+                                          element->GetAppliedStyle());
+        for (const auto& name: chain)
+            _elements[name].Insert(element);
+        _element_styles[element] = chain;
+    }
+
+    /// Return number of indexed elements.
+    unsigned GetNumIndexed() const { return _element_styles.Size(); }
+
+protected:
+    void Clear()
+    {
+        _elements.Clear();
+        _element_styles.Clear();
+        _chains.Clear();
+        _pending.Clear();
+    }
+
+    void OnElementAdded(VariantMap& args)
+    {
+        // Style of new element is usually set after it was added, it is read when pending elements are indexed.
+        auto element = static_cast<UIElement*>(args[ElementAdded::P_ELEMENT].GetPtr());
+        _pending.Push(WeakPtr<UIElement>(element));
+    }
+
+    void OnElementRemoved(VariantMap& args)
+    {
+        RemoveTree(static_cast<UIElement*>(args[ElementRemoved::P_ELEMENT].GetPtr()));
+    }
+
+    void IndexPending()
+    {
+        HashSet<UIElement*> pending;
+        for (const auto& element: _pending)
+        {
+            if (element.NotNull())
+                pending.Insert(element.Get());
+        }
+        _pending.Clear();
+
+        for (auto element: pending)
+        {
+            // Element may have been removed again, and subtree of a pending ancestor is indexed with that ancestor.
+            auto parent = element->GetParent();
+            while (parent != nullptr && parent != _root && !pending.Contains(parent))
+                parent = parent->GetParent();
+            if (parent == _root)
+                IndexTree(element);
+        }
+    }
+
+    void IndexTree(UIElement* element)
+    {
+        UpdateElement(element);
+        for (const auto& child: element->GetChildren())
+            IndexTree(child);
+    }
+
+    void RemoveElement(UIElement* element)
+    {
+        auto it = _element_styles.Find(element);
+        if (it == _element_styles.End())
+            return;
+
+        for (const auto& name: it->second_)
+        {
+            auto jt = _elements.Find(name);
+            if (jt != _elements.End())
+                jt->second_.Erase(element);
+        }
+        _element_styles.Erase(it);
+    }
+
+    void RemoveTree(UIElement* element)
+    {
+        RemoveElement(element);
+        for (const auto& child: element->GetChildren())
+            RemoveTree(child);
+    }
+
+    /// Set changed attribute of `target`, which is `element` or its internal descendant styled by a nested style. Value
+    /// is changed only when it equals value `target` got from style before the change. Return true if it was changed.
+    bool RestyleAttribute(UIElement* target, UIElement* element, const StyleAttributeChange& change, bool nested)
+    {
+        auto info = FindAttributeInfo(target, change.name);
+        if (info == nullptr || _style_file.Null())
+            return false;
+
+        auto style_root = _style_file->GetRoot();
+        auto attribute = GetStyleAttribute(change.style, change.name);
+        // Value style chain gives when changed style does not set the attribute. Nested styles have no base styles.
+        auto base_attribute = nested ? XMLElement() :
+                              FindStyleAttribute(style_root, FindStyle(style_root, change.style.GetAttribute("style")),
+                                                 change.name);
+        if (!nested)
+        {
+            // A style between applied style and changed style may set the attribute, then element is not affected.
+            const auto& applied_style = element->GetAppliedStyle();
+            auto provider = FindStyleAttribute(style_root, FindStyle(style_root, applied_style.Empty() ?
+                                               element->GetTypeName() : applied_style), change.name);
+            auto expected = attribute.NotNull() ? attribute : base_attribute;
+            if (provider.GetNode() != expected.GetNode())
+                return false;
+        }
+
+        auto fallback = base_attribute.NotNull() ? GetAttributeValue(base_attribute, *info) : info->defaultValue_;
+        auto old_value = change.old_value.IsEmpty() ? fallback : GetAttributeValue(change.old_value.GetString(), *info);
+        auto new_value = attribute.NotNull() ? GetAttributeValue(attribute, *info) : fallback;
+        if (old_value == new_value || target->GetAttribute(change.name) != old_value)
+            return false;
+
+        target->SetAttribute(change.name, new_value);
+        return true;
+    }
+
+    /// Return internal descendant of `element` styled by the last of `nesting` styles nested in `style`, or `element`
+    /// itself when `nesting` is empty. Internal children are matched by type in order, like UIElement::LoadXML()
+    /// does.
+    static UIElement* FindInternalElement(UIElement* element, XMLElement style, const Vector<XMLElement>& nesting)
+    {
+        for (const auto& nested: nesting)
+        {
+            UIElement* match = nullptr;
+            unsigned next_child = 0;
+            const auto& children = element->GetChildren();
+            for (auto child_style = style.GetChild("element"); child_style.NotNull();
+                 child_style = child_style.GetNext("element"))
+            {
+                if (!child_style.GetBool("internal"))
+                    continue;
+
+                auto type = child_style.GetAttribute("type");
+                if (type.Empty())
+                    type = UIElement::GetTypeNameStatic();
+                match = nullptr;
+                for (auto i = next_child; i < children.Size(); i++)
+                {
+                    if (children[i]->IsInternal() && children[i]->GetTypeName() == type)
+                    {
+                        match = children[i];
+                        next_child = i + 1;
+                        break;
+                    }
+                }
+                if (child_style.GetNode() == nested.GetNode())
+                    break;
+            }
+            if (match == nullptr || !nested.GetBool("internal"))
+                return nullptr;
+            element = match;
+            style = nested;
+        }
+        return element;
+    }
+
+    /// Return `name` followed by names of its base styles.
+    const Vector<String>& GetStyleChain(const String& name)
+    {
+        auto it = _chains.Find(name);
+        if (it != _chains.End())
+            return it->second_;
+
+        auto& chain = _chains[name];
+        auto style_root = _style_file.NotNull() ? _style_file->GetRoot() : XMLElement();
+        auto base = name;
+        for (unsigned depth = 0; !base.Empty() && depth < MAX_STYLE_DEPTH && !chain.Contains(base); depth++)
+        {
+            chain.Push(base);
+            auto style = style_root.IsNull() ? XMLElement() : FindStyle(style_root, base);
+            base = style.IsNull() ? String::EMPTY : style.GetAttribute("style");
+        }
+        return chain;
+    }
+
+    WeakPtr<UIElement> _root;
+    WeakPtr<XMLFile> _style_file;
+    /// Style name -> elements whose style chain contains it.
+    HashMap<String, HashSet<UIElement*>> _elements;
+    /// Element -> its style chain, needed for removing it from index.
+    HashMap<UIElement*, Vector<String>> _element_styles;
+    /// Style name -> its style chain, valid for current style file.
+    HashMap<String, Vector<String>> _chains;
+    /// Elements added since last ApplyPendingRestyle().
+    Vector<WeakPtr<UIElement>> _pending;
+    /// Style attributes changed since last ApplyPendingRestyle().
+    Vector<StyleAttributeChange> _changes;
+};
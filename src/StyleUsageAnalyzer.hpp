@@ -0,0 +1,211 @@
+#pragma once
+
+
+#include <Atomic/Container/HashMap.h>
+#include <Atomic/Container/HashSet.h>
+#include <Atomic/Container/Sort.h>
+#include <Atomic/Core/Context.h>
+#include <Atomic/Core/Object.h>
+#include <Atomic/Core/WorkQueue.h>
+#include <Atomic/IO/FileSystem.h>
+#include <Atomic/Resource/XMLFile.h>
+
+#include <UrhoUI.h>
+
+#include "TraceRecorder.hpp"
+
+using namespace Atomic;
+using namespace Atomic::UrhoUI;
+
+
+/// Styles referenced by a single layout file.
+struct LayoutStyleUsage
+{
+    String file_path;
+    /// False when file could not be parsed.
+    bool loaded = false;
+    /// False when file parsed, but is not a layout (for example it is a style sheet).
+    bool is_layout = false;
+    HashSet<String> styles;
+};
+
+/// Finds styles that no layout references, directly or as a base style or style of internal element of a referenced
+/// style. Layouts are parsed in parallel on the work queue.
+class StyleUsageAnalyzer : public Object
+{
+    ATOMIC_OBJECT(StyleUsageAnalyzer, Object);
+public:
+    explicit StyleUsageAnalyzer(Context* ctx) : Object(ctx) { }
+
+    /// Return .xml files from `paths`, directories are scanned recursively.
+    Vector<String> FindLayoutFiles(const Vector<String>& paths)
+    {
+        auto fs = GetSubsystem<FileSystem>();
+        Vector<String> files;
+        for (const auto& path: paths)
+        {
+            if (!fs->DirExists(path))
+            {
+                files.Push(path);
+                continue;
+            }
+
+            Vector<String> found;
+            fs->ScanDir(found, path, "*.xml", SCAN_FILES, true);
+            Sort(found.Begin(), found.End());
+            for (const auto& name: found)
+                files.Push(AddTrailingSlash(path) + name);
+        }
+        return files;
+    }
+
+    /// Scan `layout_paths` and compute styles of `style_file` that are used. Styles in `keep` are always treated as
+    /// used, for example styles set from code.
+    void Analyze(const Vector<String>& layout_paths, XMLFile* style_file, const Vector<String>& keep)
+    {
+        _layouts.Clear();
+        _layouts.Resize(layout_paths.Size());
+        for (unsigned i = 0; i < layout_paths.Size(); i++)
+            _layouts[i].file_path = layout_paths[i];
+
+        auto queue = GetSubsystem<WorkQueue>();
+        for (auto& layout: _layouts)
+        {
+            SharedPtr<WorkItem> item = queue->GetFreeItem();
+            item->priority_ = M_MAX_UNSIGNED;
+            item->workFunction_ = ScanLayoutWork;
+            item->aux_ = context_;
+            item->start_ = &layout;
+            queue->AddWorkItem(item);
+        }
+        queue->Complete(M_MAX_UNSIGNED);
+
+        // Index top level styles by name.
+        HashMap<String, XMLElement> styles;
+        _styles.Clear();
+        if (style_file != nullptr)
+        {
+            for (auto style = style_file->GetRoot().GetChild("element"); style.NotNull();
+                 style = style.GetNext("element"))
+            {
+                auto name = style.GetAttribute("type");
+                if (!name.Empty() && !styles.Contains(name))
+                {
+                    styles[name] = style;
+                    _styles.Push(name);
+                }
+            }
+        }
+
+        Vector<String> pending(keep);
+        for (const auto& layout: _layouts)
+        {
+            for (const auto& name: layout.styles)
+                pending.Push(name);
+        }
+
+        _used.Clear();
+        _undefined.Clear();
+        while (!pending.Empty())
+        {
+            auto name = pending.Back();
+            pending.Pop();
+            if (_used.Contains(name))
+                continue;
+            _used.Insert(name);
+
+            auto it = styles.Find(name);
+            if (it == styles.End())
+            {
+                _undefined.Push(name);
+                continue;
+            }
+
+            auto base = it->second_.GetAttribute("style");
+            if (!base.Empty())
+                pending.Push(base);
+            CollectNestedStyles(it->second_, pending);
+        }
+
+        _unused.Clear();
+        for (const auto& name: _styles)
+        {
+            if (!_used.Contains(name))
+                _unused.Push(name);
+        }
+        Sort(_unused.Begin(), _unused.End());
+        Sort(_undefined.Begin(), _undefined.End());
+    }
+
+    /// Write copy of `style_file` without unused styles to `file_path`.
+    bool SavePruned(XMLFile* style_file, const String& file_path)
+    {
+        XMLFile pruned(context_);
+        auto root = pruned.CreateRoot(style_file->GetRoot().GetName());
+        for (auto style = style_file->GetRoot().GetChild(); style.NotNull(); style = style.GetNext())
+        {
+            if (style.GetName() != "element" || _used.Contains(style.GetAttribute("type")))
+                root.AppendChild(style, true);
+        }
+
+        File file(context_, file_path, FILE_WRITE);
+        return file.IsOpen() && pruned.Save(file);
+    }
+
+    const Vector<LayoutStyleUsage>& GetLayouts() const { return _layouts; }
+    /// Return names of styles defined in style sheet, in style sheet order.
+    const Vector<String>& GetStyles() const { return _styles; }
+    /// Return sorted names of styles no layout uses.
+    const Vector<String>& GetUnused() const { return _unused; }
+    /// Return sorted names of styles layouts use, but style sheet does not define.
+    const Vector<String>& GetUndefined() const { return _undefined; }
+
+protected:
+    static void ScanLayoutWork(const WorkItem* item, unsigned)
+    {
+        auto context = static_cast<Context*>(item->aux_);
+        TraceZone trace_zone(context->GetSubsystem<TraceRecorder>(), "StyleUsageAnalyzer::ScanLayout", "worker");
+        auto& layout = *static_cast<LayoutStyleUsage*>(item->start_);
+        XMLFile xml(context);
+        layout.loaded = xml.LoadFile(layout.file_path);
+        layout.is_layout = layout.loaded && xml.GetRoot().GetName() == "element";
+        if (layout.is_layout)
+            CollectLayoutStyles(xml.GetRoot(), layout.styles);
+    }
+
+    /// Collect styles elements of layout get when loaded with a style file.
+    static void CollectLayoutStyles(const XMLElement& element, HashSet<String>& styles)
+    {
+        auto style = element.GetAttribute("style");
+        if (style.Empty() && !element.GetBool("internal"))
+        {
+            // Same fallback UIElement uses, style is named after element type.
+            style = element.GetAttribute("type");
+            if (style.Empty())
+                style = UIElement::GetTypeNameStatic();
+        }
+        if (!style.Empty() && style != "none")
+            styles.Insert(style);
+
+        for (auto child = element.GetChild("element"); child.NotNull(); child = child.GetNext("element"))
+            CollectLayoutStyles(child, styles);
+    }
+
+    /// Collect styles referenced by internal elements nested in `style`.
+    static void CollectNestedStyles(const XMLElement& style, Vector<String>& styles)
+    {
+        for (auto child = style.GetChild("element"); child.NotNull(); child = child.GetNext("element"))
+        {
+            auto name = child.GetAttribute("style");
+            if (!name.Empty() && name != "none")
+                styles.Push(name);
+            CollectNestedStyles(child, styles);
+        }
+    }
+
+    Vector<LayoutStyleUsage> _layouts;
+    Vector<String> _styles;
+    HashSet<String> _used;
+    Vector<String> _unused;
+    Vector<String> _undefined;
+};
@@ -0,0 +1,512 @@
+#pragma once
+
+
+#include <Atomic/Container/HashMap.h>
+#include <Atomic/Container/HashSet.h>
+#include <Atomic/Container/Sort.h>
+#include <Atomic/Container/Vector.h>
+#include <Atomic/Core/Object.h>
+#include <Atomic/Graphics/Texture2D.h>
+#include <Atomic/IO/FileSystem.h>
+#include <Atomic/Resource/Image.h>
+#include <Atomic/Resource/ResourceCache.h>
+#include <Atomic/Resource/XMLFile.h>
+
+#include <UrhoUI.h>
+
+#include "ElementUtils.hpp"
+
+using namespace Atomic;
+using namespace Atomic::UrhoUI;
+
+
+/// Skyline bottom-left rectangle packer. Keeps only the top outline of placed rectangles, so insertion cost depends
+/// on number of outline segments instead of number of free rectangles.
+class SkylinePacker
+{
+public:
+    void Reset(int width, int height)
+    {
+        _width = width;
+        _height = height;
+        _skyline.Clear();
+        _skyline.Push({0, 0, width});
+    }
+
+    /// Find position for rectangle of given size. Return false when it does not fit.
+    bool Insert(int width, int height, IntVector2& position)
+    {
+        auto best_index = M_MAX_UNSIGNED;
+        auto best_bottom = M_MAX_INT;
+        auto best_segment_width = M_MAX_INT;
+        auto best_y = 0;
+        for (unsigned i = 0; i < _skyline.Size(); i++)
+        {
+            auto y = Fit(i, width, height);
+            if (y < 0)
+                continue;
+
+            // Lowest bottom edge wins, narrower segment breaks ties so wide gaps stay available.
+            if (y + height < best_bottom || (y + height == best_bottom && _skyline[i].width < best_segment_width))
+            {
+                best_index = i;
+                best_bottom = y + height;
+                best_segment_width = _skyline[i].width;
+                best_y = y;
+            }
+        }
+
+        if (best_index == M_MAX_UNSIGNED)
+            return false;
+
+        position = IntVector2(_skyline[best_index].x, best_y);
+        _skyline.Insert(best_index, {position.x_, best_bottom, width});
+
+        // Cut segments covered by new one.
+        for (auto i = best_index + 1; i < _skyline.Size();)
+        {
+            const auto& previous = _skyline[i - 1];
+            auto& segment = _skyline[i];
+            auto overlap = previous.x + previous.width - segment.x;
+            if (overlap <= 0)
+                break;
+
+            segment.x += overlap;
+            segment.width -= overlap;
+            if (segment.width > 0)
+                break;
+            _skyline.Erase(i);
+        }
+
+        // Merge neighbours of same height.
+        for (unsigned i = 0; i + 1 < _skyline.Size();)
+        {
+            if (_skyline[i].y == _skyline[i + 1].y)
+            {
+                _skyline[i].width += _skyline[i + 1].width;
+                _skyline.Erase(i + 1);
+            }
+            else
+                i++;
+        }
+        return true;
+    }
+
+protected:
+    struct Segment
+    {
+        int x;
+        int y;
+        int width;
+    };
+
+    /// Return top edge of rectangle placed at start of segment `index` or -1 if it does not fit.
+    int Fit(unsigned index, int width, int height) const
+    {
+        if (_skyline[index].x + width > _width)
+            return -1;
+
+        auto y = 0;
+        auto remaining = width;
+        for (auto i = index; remaining > 0 && i < _skyline.Size(); i++)
+        {
+            y = Max(y, _skyline[i].y);
+            if (y + height > _height)
+                return -1;
+            remaining -= _skyline[i].width;
+        }
+        return y;
+    }
+
+    PODVector<Segment> _skyline;
+    int _width = 0;
+    int _height = 0;
+};
+
+/// Texture and image rect a style element uses, resolved through its base styles.
+struct StyleImageReference
+{
+    XMLElement style;
+    String texture;
+    IntRect rect;
+    PODVector<IntVector2> offsets;
+    /// Style element sets texture itself.
+    bool own_texture = false;
+    /// Style element sets image rect itself.
+    bool own_rect = false;
+};
+
+/// Packs images referenced by `Texture` attributes of elements and styles into atlas pages and maps their image
+/// rects to atlas coordinates.
+class TextureAtlasPacker : public Object
+{
+    ATOMIC_OBJECT(TextureAtlasPacker, Object);
+public:
+    static const int DEFAULT_MAX_SIZE = 2048;
+    static const int DEFAULT_PADDING = 1;
+
+    explicit TextureAtlasPacker(Context* ctx) : Object(ctx) { }
+
+    void Clear()
+    {
+        _sources.Clear();
+        _source_index.Clear();
+        _pages.Clear();
+        _page_names.Clear();
+        _error.Clear();
+    }
+
+    /// Collect image references of `element` and all its descendants.
+    void CollectElements(UIElement* element)
+    {
+        String texture;
+        IntRect rect;
+        PODVector<IntVector2> offsets;
+        if (GetElementImage(element, texture, rect, offsets))
+            AddReference(texture, rect, offsets);
+
+        for (const auto& child: element->GetChildren())
+            CollectElements(child);
+    }
+
+    void CollectStyle(XMLFile* style_file)
+    {
+        for (const auto& reference: GetStyleReferences(style_file))
+            AddReference(reference.texture, reference.rect, reference.offsets);
+    }
+
+    /// Pack used parts of collected images into pages of at most `max_size` pixels. Edge pixels of every image are
+    /// repeated `padding` times around it so filtering does not sample neighbours. Images that do not fit into a page
+    /// are left out.
+    bool Pack(int max_size = DEFAULT_MAX_SIZE, int padding = DEFAULT_PADDING)
+    {
+        _pages.Clear();
+        _page_names.Clear();
+
+        PODVector<unsigned> order;
+        for (unsigned i = 0; i < _sources.Size(); i++)
+        {
+            auto& source = _sources[i];
+            source.page = M_MAX_UNSIGNED;
+            if (source.image.NotNull() && source.used.Width() > 0 && source.used.Height() > 0)
+                order.Push(i);
+        }
+
+        if (order.Empty())
+        {
+            _error = "Layout does not reference any uncompressed images.";
+            return false;
+        }
+
+        // Tall images first keep skyline flat.
+        Sort(order.Begin(), order.End(), [this](unsigned a, unsigned b) {
+            const auto& rect_a = _sources[a].used;
+            const auto& rect_b = _sources[b].used;
+            if (rect_a.Height() != rect_b.Height())
+                return rect_a.Height() > rect_b.Height();
+            return rect_a.Width() > rect_b.Width();
+        });
+
+        Vector<SkylinePacker> packers;
+        PODVector<IntVector2> page_sizes;
+        for (auto index: order)
+        {
+            auto& source = _sources[index];
+            auto width = source.used.Width() + padding * 2;
+            auto height = source.used.Height() + padding * 2;
+            if (width > max_size || height > max_size)
+                continue;
+
+            IntVector2 position;
+            for (unsigned page = 0; page < packers.Size() && source.page == M_MAX_UNSIGNED; page++)
+            {
+                if (packers[page].Insert(width, height, position))
+                    source.page = page;
+            }
+
+            if (source.page == M_MAX_UNSIGNED)
+            {
+                source.page = packers.Size();
+                packers.Resize(packers.Size() + 1);
+                packers.Back().Reset(max_size, max_size);
+                packers.Back().Insert(width, height, position);
+                page_sizes.Push(IntVector2::ZERO);
+            }
+
+            source.position = position + IntVector2(padding, padding);
+            auto& page_size = page_sizes[source.page];
+            page_size.x_ = Max(page_size.x_, position.x_ + width);
+            page_size.y_ = Max(page_size.y_, position.y_ + height);
+        }
+
+        if (packers.Empty())
+        {
+            _error = ToString("Referenced images do not fit into %dx%d atlas.", max_size, max_size);
+            return false;
+        }
+
+        for (const auto& page_size: page_sizes)
+        {
+            SharedPtr<Image> page(new Image(context_));
+            page->SetSize(page_size.x_, page_size.y_, 4);
+            page->Clear(Color::TRANSPARENT);
+            _pages.Push(page);
+        }
+
+        for (const auto& source: _sources)
+        {
+            if (source.page == M_MAX_UNSIGNED)
+                continue;
+
+            auto page = _pages[source.page];
+            const auto& used = source.used;
+            for (auto y = -padding; y < used.Height() + padding; y++)
+            {
+                auto source_y = Clamp(used.top_ + y, used.top_, used.bottom_ - 1);
+                for (auto x = -padding; x < used.Width() + padding; x++)
+                {
+                    auto source_x = Clamp(used.left_ + x, used.left_, used.right_ - 1);
+                    page->SetPixelInt(source.position.x_ + x, source.position.y_ + y,
+                                      source.image->GetPixelInt(source_x, source_y));
+                }
+            }
+        }
+        return true;
+    }
+
+    /// Write pages as PNG files. First page is written to `file_path`, following pages get page index appended.
+    /// `resource_name` is the name of `file_path` in resource cache.
+    bool Save(const String& file_path, const String& resource_name)
+    {
+        auto cache = GetSubsystem<ResourceCache>();
+        _page_names.Clear();
+        for (unsigned i = 0; i < _pages.Size(); i++)
+        {
+            auto page_path = GetPagePath(file_path, i);
+            if (!_pages[i]->SavePNG(page_path))
+            {
+                _error = "Saving texture atlas failed: " + page_path;
+                return false;
+            }
+
+            // Texture of previous atlas may still be cached.
+            auto page_name = GetPagePath(resource_name, i);
+            if (auto texture = cache->GetExistingResource<Texture2D>(page_name))
+                cache->ReloadResource(texture);
+            _page_names.Push(page_name);
+        }
+        return true;
+    }
+
+    /// Give pages resource names of atlas saved as `resource_name` without writing them. Replay uses it, files are
+    /// not written there.
+    void SetPageNames(const String& resource_name)
+    {
+        _page_names.Clear();
+        for (unsigned i = 0; i < _pages.Size(); i++)
+            _page_names.Push(GetPagePath(resource_name, i));
+    }
+
+    /// Map image rect of `texture` to atlas. Return false when texture was not packed.
+    bool Remap(const String& texture, const IntRect& rect, String& atlas_texture, IntRect& atlas_rect) const
+    {
+        auto it = _source_index.Find(texture);
+        if (it == _source_index.End())
+            return false;
+
+        const auto& source = _sources[it->second_];
+        if (source.page >= _page_names.Size())
+            return false;
+
+        auto image_rect = rect == IntRect::ZERO ? GetFullRect(source.image) : rect;
+        auto offset = source.position - IntVector2(source.used.left_, source.used.top_);
+        atlas_rect = IntRect(image_rect.left_ + offset.x_, image_rect.top_ + offset.y_, image_rect.right_ + offset.x_,
+                             image_rect.bottom_ + offset.y_);
+        atlas_texture = _page_names[source.page];
+        return true;
+    }
+
+    /// Return number of source textures that were packed.
+    unsigned GetNumPackedTextures() const
+    {
+        unsigned count = 0;
+        for (const auto& source: _sources)
+            count += source.page < _pages.Size();
+        return count;
+    }
+
+    unsigned GetNumTextures() const { return _sources.Size(); }
+    const Vector<SharedPtr<Image>>& GetPages() const { return _pages; }
+    /// Return resource names of saved pages.
+    const Vector<String>& GetPageNames() const { return _page_names; }
+    const String& GetError() const { return _error; }
+
+    /// Read texture, image rect and image offsets (hover, pressed, ...) of element. Return false if element has no
+    /// texture.
+    static bool GetElementImage(Serializable* element, String& texture, IntRect& rect, PODVector<IntVector2>& offsets)
+    {
+        const auto& texture_value = element->GetAttribute("Texture");
+        if (texture_value.GetType() != VAR_RESOURCEREF || texture_value.GetResourceRef().name_.Empty())
+            return false;
+
+        texture = texture_value.GetResourceRef().name_;
+        rect = element->GetAttribute("Image Rect").GetIntRect();
+        offsets.Clear();
+        if (auto attributes = element->GetAttributes())
+        {
+            for (const auto& info: *attributes)
+            {
+                if (info.type_ == VAR_INTVECTOR2 && info.name_.EndsWith("Image Offset"))
+                    offsets.Push(element->GetAttribute(info.name_).GetIntVector2());
+            }
+        }
+        return true;
+    }
+
+    /// Return style elements (including nested internal child styles) that set texture or image rect.
+    static Vector<StyleImageReference> GetStyleReferences(XMLFile* style_file)
+    {
+        Vector<StyleImageReference> references;
+        if (style_file != nullptr)
+            CollectStyleReferences(style_file->GetRoot(), style_file->GetRoot(), references);
+        return references;
+    }
+
+protected:
+    struct Source
+    {
+        String texture;
+        SharedPtr<Image> image;
+        /// Union of image rects referencing the texture, only this part is packed.
+        IntRect used;
+        unsigned page = M_MAX_UNSIGNED;
+        /// Position of top left corner of `used` in atlas page.
+        IntVector2 position;
+    };
+
+    static IntRect GetFullRect(Image* image)
+    {
+        return image == nullptr ? IntRect::ZERO : IntRect(0, 0, image->GetWidth(), image->GetHeight());
+    }
+
+    static String GetPagePath(const String& path, unsigned page)
+    {
+        if (page == 0)
+            return path;
+        return ReplaceExtension(path, ToString("_%u", page) + GetExtension(path, false));
+    }
+
+    void AddReference(const String& texture, const IntRect& rect, const PODVector<IntVector2>& offsets)
+    {
+        auto it = _source_index.Find(texture);
+        if (it == _source_index.End())
+        {
+            Source source;
+            source.texture = texture;
+            source.image = GetSubsystem<ResourceCache>()->GetResource<Image>(texture);
+            // Pixels of compressed images can not be copied.
+            if (source.image.NotNull() && source.image->IsCompressed())
+                source.image.Reset();
+            source.used = IntRect::ZERO;
+            it = _source_index.Insert(MakePair(texture, _sources.Size()));
+            _sources.Push(source);
+        }
+
+        auto& source = _sources[it->second_];
+        if (source.image.Null())
+            return;
+
+        auto full_rect = GetFullRect(source.image);
+        auto image_rect = rect == IntRect::ZERO ? full_rect : rect;
+        Include(source.used, image_rect, full_rect);
+        for (const auto& offset: offsets)
+        {
+            if (offset != IntVector2::ZERO)
+            {
+                Include(source.used, IntRect(image_rect.left_ + offset.x_, image_rect.top_ + offset.y_,
+                                             image_rect.right_ + offset.x_, image_rect.bottom_ + offset.y_), full_rect);
+            }
+        }
+    }
+
+    /// Grow `used` to contain `rect` clipped to image bounds.
+    static void Include(IntRect& used, IntRect rect, const IntRect& bounds)
+    {
+        rect.left_ = Clamp(rect.left_, bounds.left_, bounds.right_);
+        rect.right_ = Clamp(rect.right_, bounds.left_, bounds.right_);
+        rect.top_ = Clamp(rect.top_, bounds.top_, bounds.bottom_);
+        rect.bottom_ = Clamp(rect.bottom_, bounds.top_, bounds.bottom_);
+        if (rect.Width() <= 0 || rect.Height() <= 0)
+            return;
+
+        if (used.Width() <= 0 || used.Height() <= 0)
+            used = rect;
+        else
+        {
+            used.left_ = Min(used.left_, rect.left_);
+            used.top_ = Min(used.top_, rect.top_);
+            used.right_ = Max(used.right_, rect.right_);
+            used.bottom_ = Max(used.bottom_, rect.bottom_);
+        }
+    }
+
+    static void CollectStyleReferences(const XMLElement& root, const XMLElement& parent,
+                                       Vector<StyleImageReference>& references)
+    {
+        for (auto style = parent.GetChild("element"); style.NotNull(); style = style.GetNext("element"))
+        {
+            StyleImageReference reference;
+            reference.style = style;
+            reference.own_texture = GetStyleAttribute(style, "Texture").NotNull();
+            reference.own_rect = GetStyleAttribute(style, "Image Rect").NotNull();
+            if ((reference.own_texture || reference.own_rect) && ResolveStyleImage(root, reference))
+                references.Push(reference);
+
+            CollectStyleReferences(root, style, references);
+        }
+    }
+
+    /// Fill texture, rect and offsets of `reference` from its style element and base styles. Values set closer to
+    /// the style element win.
+    static bool ResolveStyleImage(const XMLElement& root, StyleImageReference& reference)
+    {
+        auto has_texture = false;
+        auto has_rect = false;
+        HashSet<String> offset_names;
+        auto style = reference.style;
+        for (unsigned depth = 0; style.NotNull() && depth < MAX_STYLE_DEPTH; depth++)
+        {
+            for (auto attribute = style.GetChild("attribute"); attribute.NotNull();
+                 attribute = attribute.GetNext("attribute"))
+            {
+                auto name = attribute.GetAttribute("name");
+                if (name == "Texture" && !has_texture)
+                {
+                    reference.texture = attribute.GetVariantValue(VAR_RESOURCEREF).GetResourceRef().name_;
+                    has_texture = true;
+                }
+                else if (name == "Image Rect" && !has_rect)
+                {
+                    reference.rect = attribute.GetVariantValue(VAR_INTRECT).GetIntRect();
+                    has_rect = true;
+                }
+                else if (name.EndsWith("Image Offset") && !offset_names.Contains(name))
+                {
+                    offset_names.Insert(name);
+                    reference.offsets.Push(attribute.GetVariantValue(VAR_INTVECTOR2).GetIntVector2());
+                }
+            }
+
+            auto base_style = style.GetAttribute("style");
+            style = base_style.Empty() ? XMLElement() : FindStyle(root, base_style);
+        }
+        return !reference.texture.Empty();
+    }
+
+    Vector<Source> _sources;
+    /// Map of texture name to index in `_sources`.
+    HashMap<String, unsigned> _source_index;
+    Vector<SharedPtr<Image>> _pages;
+    Vector<String> _page_names;
+    String _error;
+};
@@ -0,0 +1,192 @@
+#pragma once
+
+
+#include <Atomic/Core/Object.h>
+#include <Atomic/Core/CoreEvents.h>
+#include <Atomic/Core/Mutex.h>
+#include <Atomic/IO/File.h>
+#include <Atomic/IO/Log.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <unordered_map>
+
+using namespace Atomic;
+
+
+/// Records scoped zones from any thread and exports them in Chrome trace-event format.
+class TraceRecorder : public Object
+{
+    ATOMIC_OBJECT(TraceRecorder, Object);
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    struct Zone
+    {
+        const char* name;
+        const char* category;
+        unsigned thread;
+        Clock::time_point start;
+        Clock::time_point end;
+    };
+
+    TraceRecorder(Context* ctx) : Object(ctx)
+    {
+        SubscribeToEvent(E_BEGINFRAME, std::bind(&TraceRecorder::OnBeginFrame, this));
+    }
+
+    bool IsRecording() const { return _recording; }
+
+    const String& GetFilePath() const { return _file_path; }
+
+    /// Start recording zones. They are written to `file_path` when recording stops.
+    void Start(const String& file_path)
+    {
+        if (_recording)
+            Stop();
+
+        MutexLock lock(_mutex);
+        _file_path = file_path;
+        _zones.Clear();
+        _threads.clear();
+        // Thread that starts recording is considered to be the main thread.
+        GetThreadIndex();
+        _start = _frame_start = Clock::now();
+        _recording = true;
+        context_->GetLog()->Write(LOG_INFO, ToString("TRACE: Recording to %s", _file_path.CString()));
+    }
+
+    /// Stop recording and write trace file.
+    bool Stop()
+    {
+        if (!_recording)
+            return false;
+
+        _recording = false;
+        MutexLock lock(_mutex);
+        File file(context_, _file_path, FILE_WRITE);
+        if (!file.IsOpen())
+        {
+            context_->GetLog()->Write(LOG_ERROR, ToString("TRACE: Could not open %s", _file_path.CString()));
+            _zones.Clear();
+            return false;
+        }
+
+        // Thread name metadata always comes first so every following event can be prefixed with a separator.
+        char line[LINE_SIZE];
+        WriteLine(file, line, snprintf(line, sizeof(line), "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n"));
+        const char* separator = "";
+        for (const auto& it: _threads)
+        {
+            const char* thread_name = it.second == 0 ? "Main thread" : "Worker thread";
+            WriteLine(file, line, snprintf(line, sizeof(line),
+                "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s %u\"}}\n",
+                separator, it.second, thread_name, it.second));
+            separator = ",";
+        }
+
+        for (const Zone& zone: _zones)
+        {
+            WriteLine(file, line, snprintf(line, sizeof(line),
+                "%s{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}\n",
+                separator, zone.name, zone.category, zone.thread, ToMicroseconds(zone.start - _start),
+                ToMicroseconds(zone.end - zone.start)));
+            separator = ",";
+        }
+        WriteLine(file, line, snprintf(line, sizeof(line), "]}\n"));
+
+        context_->GetLog()->Write(LOG_INFO, ToString("TRACE: Wrote %d zones to %s", _zones.Size(),
+                                                     _file_path.CString()));
+        _zones.Clear();
+        return true;
+    }
+
+    /// Record a zone. Safe to call from worker threads. `name` and `category` must be string literals.
+    void AddZone(const char* name, const char* category, Clock::time_point start, Clock::time_point end)
+    {
+        if (!_recording)
+            return;
+
+        MutexLock lock(_mutex);
+        Zone zone;
+        zone.name = name;
+        zone.category = category;
+        zone.thread = GetThreadIndex();
+        zone.start = start;
+        zone.end = end;
+        _zones.Push(zone);
+    }
+
+protected:
+    void OnBeginFrame()
+    {
+        if (!_recording)
+            return;
+
+        auto now = Clock::now();
+        AddZone("Frame", "frame", _frame_start, now);
+        _frame_start = now;
+    }
+
+    /// Return small sequential index of calling thread. Must be called with `_mutex` locked.
+    unsigned GetThreadIndex()
+    {
+        auto id = std::this_thread::get_id();
+        auto it = _threads.find(id);
+        if (it != _threads.end())
+            return it->second;
+        auto index = static_cast<unsigned>(_threads.size());
+        _threads[id] = index;
+        return index;
+    }
+
+    static double ToMicroseconds(Clock::duration duration)
+    {
+        return std::chrono::duration<double, std::micro>(duration).count();
+    }
+
+    /// Write formatted line, `length` is a return value of snprintf() into buffer of `LINE_SIZE` bytes.
+    static void WriteLine(File& file, const char* line, int length)
+    {
+        if (length > 0)
+            file.Write(line, Min<unsigned>(static_cast<unsigned>(length), LINE_SIZE - 1));
+    }
+
+    static const unsigned LINE_SIZE = 512;
+
+    std::atomic<bool> _recording{false};
+    String _file_path;
+    Mutex _mutex;
+    PODVector<Zone> _zones;
+    std::unordered_map<std::thread::id, unsigned> _threads;
+    Clock::time_point _start;
+    Clock::time_point _frame_start;
+};
+
+/// Records enclosing block as a trace zone. Does nothing when recorder is not recording.
+class TraceZone
+{
+public:
+    TraceZone(TraceRecorder* recorder, const char* name, const char* category)
+        : _recorder(recorder != nullptr && recorder->IsRecording() ? recorder : nullptr)
+        , _name(name)
+        , _category(category)
+    {
+        if (_recorder)
+            _start = TraceRecorder::Clock::now();
+    }
+
+    ~TraceZone()
+    {
+        if (_recorder)
+            _recorder->AddZone(_name, _category, _start, TraceRecorder::Clock::now());
+    }
+
+protected:
+    TraceRecorder* _recorder;
+    const char* _name;
+    const char* _category;
+    TraceRecorder::Clock::time_point _start;
+};
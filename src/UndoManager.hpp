@@ -1,13 +1,25 @@
 #pragma once
 
 
+#include <Atomic/Container/Pair.h>
 #include <Atomic/Container/Vector.h>
 #include <Atomic/Core/Object.h>
 #include <Atomic/Scene/Serializable.h>
+#include <Atomic/IO/Compression.h>
+#include <Atomic/IO/File.h>
+#include <Atomic/IO/FileSystem.h>
 #include <Atomic/IO/Log.h>
+#include <Atomic/IO/MemoryBuffer.h>
+#include <Atomic/IO/VectorBuffer.h>
+#include <Atomic/Resource/XMLElement.h>
+#include <Atomic/Resource/XMLFile.h>
 
 #include <UrhoUI.h>
 
+#include "ElementUtils.hpp"
+#include "FrameProfiler.hpp"
+#include "MappedFile.hpp"
+
 using namespace Atomic;
 using namespace Atomic::UrhoUI;
 
@@ -19,26 +31,50 @@ struct UndoState
         ATTRIBUTE_CHANGED,
         UI_ADD,
         UI_REMOVE,
+        STYLE_CHANGED,
+        GROUP,
     } type = INVALID_STATE;
 
-    /// Object that was modified.
-    SharedPtr<Serializable> item;
-    /// Changed attributes.
+    /// Object that was modified. Elements are not kept alive by undo history, they are found by `item_id`.
+    WeakPtr<Serializable> item;
+    /// Id of modified element assigned by UndoManager, stays the same when removed element is rebuilt. Zero when
+    /// item is not an element.
+    unsigned item_id = 0;
+    /// Type of modified object, session file refers to its attributes by their index.
+    StringHash item_type;
+    /// Changed attributes. For style states values are strings, empty variant means attribute is not set in style.
     HashMap<String, Variant> attributes;
+    /// Style element whose attributes were modified.
+    XMLElement style;
+    /// States applied together as a single change.
+    Vector<UndoState> states;
 
-    /// Parent of `element`.
-    SharedPtr<Serializable> parent;
-    /// Index of `element` in children list of `parent`.
-    unsigned index;
+    /// Id of parent of added or removed element.
+    unsigned parent_id = 0;
+    /// Index of added or removed element in children list of its parent.
+    unsigned index = 0;
+    /// Compressed XML of removed subtree, used for rebuilding it when removed element is no longer alive.
+    VectorBuffer snapshot;
+    /// Ids of elements of removed subtree as pairs of position in recursive children list (0 is removed element
+    /// itself, 1 is its first child) and id.
+    Vector<Pair<unsigned, unsigned>> snapshot_ids;
 
+    /// Hash of state contents computed when state is tracked. States with different hashes are never equal.
+    unsigned hash = 0;
+    /// Index of previous state of the same object in undo stack, -1 if there is none.
+    int previous = -1;
 
     bool operator==(const UndoState& other) const
     {
-        if (type != other.type || item != other.item)
+        if (hash != other.hash || type != other.type || GetObjectKey() != other.GetObjectKey())
             return false;
 
         switch (type)
         {
+        case STYLE_CHANGED:
+            if (style.GetNode() != other.style.GetNode())
+                return false;
+            // Fall through to attribute comparison.
         case ATTRIBUTE_CHANGED:
         {
             if (attributes.Size() != other.attributes.Size())
@@ -56,39 +92,139 @@ struct UndoState
         }
         case UI_ADD:
         case UI_REMOVE:
-            return index == other.index && parent == other.parent;
+            return index == other.index && parent_id == other.parent_id;
+        case GROUP:
+            return states == other.states;
         default:
             return false;
         }
     }
 
-    bool Equals(const Serializable* other_item) const
+    /// Return true if attribute state holds current values of `current_item`, the live object state refers to.
+    bool Equals(const Serializable* current_item) const
     {
-        if (item != other_item)
+        if (type != ATTRIBUTE_CHANGED || current_item == nullptr)
             return false;
 
+        for (auto it: attributes)
+        {
+            if (current_item->GetAttribute(it.first_) != it.second_)
+                return false;
+        }
+        return true;
+    }
+
+    /// Return true if attribute state `other` holds the same values of all attributes this attribute state holds.
+    bool HasSameValues(const UndoState& other) const
+    {
+        if (type != ATTRIBUTE_CHANGED || other.type != ATTRIBUTE_CHANGED)
+            return false;
+
+        for (auto it: attributes)
+        {
+            auto jt = other.attributes.Find(it.first_);
+            if (jt == other.attributes.End() || jt->second_ != it.second_)
+                return false;
+        }
+        return true;
+    }
+
+    /// Return short description of the change for history panel.
+    String GetDescription() const
+    {
+        String names;
+        for (auto it: attributes)
+            names += (names.Empty() ? "" : ", ") + it.first_;
+
         switch (type)
         {
         case ATTRIBUTE_CHANGED:
+            return "Attributes: " + names;
+        case STYLE_CHANGED:
+            return "Style " + GetStyleName(style) + ": " + names;
+        case UI_ADD:
+            return "Add element";
+        case UI_REMOVE:
+            return "Remove element";
+        case GROUP:
+            return ToString("Group of %u changes", states.Size());
+        default:
+            return "Invalid";
+        }
+    }
+
+    /// Return hash of state contents. Child states of a group must have their hashes computed already.
+    unsigned ComputeHash() const
+    {
+        unsigned result = type;
+        auto key = GetObjectKey();
+        CombineHash(result, static_cast<unsigned>(key ^ (key >> 32u)));
+        switch (type)
         {
+        case STYLE_CHANGED:
+            // Fall through to attribute hash.
+        case ATTRIBUTE_CHANGED:
+        {
+            // Iteration order of attributes depends on insertion order, attribute hashes are combined by a sum.
+            unsigned attributes_hash = 0;
             for (auto it: attributes)
-            {
-                if (other_item->GetAttribute(it.first_) != it.second_)
-                    return false;
-            }
-            return true;
+                attributes_hash += StringHash(it.first_).Value() * 31 + StringHash(it.second_.ToString()).Value();
+            CombineHash(result, attributes_hash);
+            break;
         }
         case UI_ADD:
-            return DynamicCast<UIElement>(parent)->GetChild(index) == other_item;
         case UI_REMOVE:
-            return DynamicCast<UIElement>(parent)->GetChild(index) != other_item;
+            CombineHash(result, parent_id);
+            CombineHash(result, index);
+            break;
+        case GROUP:
+            for (const auto& state: states)
+                CombineHash(result, state.hash);
+            break;
         default:
-            return false;
+            break;
         }
+        return result;
+    }
+
+    /// Return object whose states replace each other: modified element id, item or style element for style states.
+    unsigned long long GetObjectKey() const
+    {
+        // Element ids have highest bit set so they never equal an address.
+        if (item_id != 0)
+            return item_id | (1ull << 63u);
+        if (type == STYLE_CHANGED)
+            return reinterpret_cast<unsigned long long>(style.GetNode());
+        return reinterpret_cast<unsigned long long>(item.Get());
     }
+
+protected:
+    static void CombineHash(unsigned& result, unsigned hash)
+    {
+        result = result * 31 + hash;
+    }
+};
+
+/// Position of undo state in history tree. Nodes are kept apart from states, so navigation touches only this small
+/// array.
+struct UndoNode
+{
+    /// Parent node, -1 for first state.
+    int parent;
+    /// Ancestor for skipping up the tree. Jump lengths follow skew binary numbers, so reaching any ancestor takes
+    /// O(log n) steps.
+    int jump;
+    /// Child that redo follows, the last one that was visited.
+    int active_child;
+    unsigned num_children;
+    unsigned depth;
+    /// First child continues branch of its parent, other children start new branches.
+    unsigned branch;
 };
 
 
+/// Undo history kept as a tree. A change made after undo starts a new branch instead of discarding redo states, any
+/// state of any branch can be returned to with JumpTo().
 class UndoManager : public Object
 {
     ATOMIC_OBJECT(UndoManager, Object);
@@ -97,63 +233,161 @@ public:
 
     void Undo()
     {
-        while (_index >= 0 && _index < _stack.Size() && !ApplyState(false))
-            _index--;
-        _index--;
-        _index = Clamp<int32_t>(_index, 0, _stack.Size()-1);
+        _modified_styles.Clear();
+        if (_stack.Empty())
+            return;
+
+        // State tracked before a change that did not happen would be skipped, it is dropped instead.
+        CompactTop();
+
+        while (_index >= 0 && !ApplyState(false))
+            _index = _nodes[_index].parent;
+        if (_index >= 0)
+            _index = _nodes[_index].parent;
+        // First state is never undone past, like bottom of a stack.
+        _index = Max(_index, 0);
     }
 
+    /// Redo along the branch that was visited last.
     void Redo()
     {
-        while (_index >= 0 && _index < _stack.Size() && !ApplyState(false))
-            _index++;
-        _index++;
-        _index = Clamp<int32_t>(_index, 0, _stack.Size()-1);
+        _modified_styles.Clear();
+        if (_stack.Empty())
+            return;
+
+        auto last = _index;
+        while (_index >= 0 && !ApplyState(true))
+        {
+            last = _index;
+            _index = _nodes[_index].active_child;
+        }
+        if (_index >= 0)
+        {
+            last = _index;
+            _index = _nodes[_index].active_child;
+        }
+        if (_index < 0)
+            _index = last;
+    }
+
+    /// Move to state `node` of any branch. States from current state up to common ancestor are undone, then states
+    /// down to `node` are redone. Redo continues along the branch of `node` afterwards.
+    void JumpTo(int node)
+    {
+        if (node < 0 || node >= static_cast<int>(_stack.Size()) || node == _index)
+            return;
+
+        TraceZone trace_zone(GetSubsystem<TraceRecorder>(), "UndoManager::JumpTo", "undo");
+        _modified_styles.Clear();
+        auto ancestor = _index >= 0 ? FindCommonAncestor(_index, node) : -1;
+        for (; _index != ancestor; _index = _nodes[_index].parent)
+            ApplyState(false);
+
+        // Snapshot of ancestor restores values that undone states of its branch changed.
+        if (_index >= 0 && _stack[_index].type != UndoState::UI_ADD && _stack[_index].type != UndoState::UI_REMOVE)
+            ApplyState(true);
+
+        PODVector<int> path;
+        for (auto i = node; i != ancestor; i = _nodes[i].parent)
+            path.Push(i);
+        for (auto i = path.Size(); i-- > 0;)
+        {
+            _index = path[i];
+            if (_nodes[_index].parent >= 0)
+                _nodes[_nodes[_index].parent].active_child = _index;
+            ApplyState(true);
+        }
+    }
+
+    /// Return current state, -1 when history is empty.
+    int GetCurrent() const { return _index; }
+    /// Return true if current state is not the one document was loaded or last saved in.
+    bool IsModified() const { return _index != _saved_index; }
+    /// Record that document was saved in current state.
+    void MarkSaved() { _saved_index = _index; }
+    unsigned GetNumStates() const { return _stack.Size(); }
+    const UndoState& GetState(unsigned index) const { return _stack[index]; }
+    const UndoNode& GetNode(unsigned index) const { return _nodes[index]; }
+    unsigned GetNumBranches() const { return _num_branches; }
+
+    /// Return true if `node` is current state or one of states undo passes through from it.
+    bool IsOnCurrentPath(int node) const
+    {
+        return _index >= 0 && node >= 0 && _nodes[node].depth <= _nodes[_index].depth &&
+               FindAncestor(_index, _nodes[node].depth) == node;
     }
 
     void TrackValue(Serializable* item, const String& name, const Variant& value)
     {
+        AllocationScope allocation_scope("UndoManager");
         UndoState state;
         state.item = item;
         if (state.item.NotNull())
         {
             state.type = UndoState::ATTRIBUTE_CHANGED;
+            state.item_id = GetElementId(dynamic_cast<UIElement*>(item));
+            state.item_type = item->GetType();
             state.attributes[name] = value;
-            _stack.Resize(++_index);
-
-            while (_stack.Size() > 0 && _stack.Back() == state)
-            {
-                context_->GetLog()->Write(LOG_DEBUG, "UNDO: Same value is already at the top of undo stack. Ignore.");
-                return;
-            }
-
-            _stack.Push(state);
-            context_->GetLog()->Write(LOG_DEBUG, ToString("UNDO: Save %d %s = %s", _index, name.CString(),
-                                                          value.ToString().CString()));
+            if (PushState(state) && IsLoggingDebug())
+                LogDebug("UNDO: Save %d %s = %s", _index, name.CString(), value.ToString().CString());
         }
     }
 
     void TrackValue(Serializable* item, const HashMap<String, Variant>& values)
     {
+        AllocationScope allocation_scope("UndoManager");
         UndoState state;
         state.item = item;
         if (state.item.NotNull())
         {
             state.type = UndoState::ATTRIBUTE_CHANGED;
+            state.item_id = GetElementId(dynamic_cast<UIElement*>(item));
+            state.item_type = item->GetType();
             state.attributes = values;
-            _stack.Resize(++_index);
+            if (PushState(state))
+                LogDebug("UNDO: Save %d", _index);
+        }
+    }
 
-            if (_stack.Size() > 0 && _stack.Back() == state)
-            {
-                context_->GetLog()->Write(LOG_DEBUG, "UNDO: Same value is already at the top of undo stack. Ignore.");
-                return;
-            }
+    /// Save values of `<attribute>` children of style element. Values are strings, empty variant is saved for
+    /// attributes that are not set.
+    void TrackStyleValue(const XMLElement& style, const HashMap<String, Variant>& values)
+    {
+        AllocationScope allocation_scope("UndoManager");
+        if (style.IsNull())
+            return;
 
-            _stack.Push(state);
-            context_->GetLog()->Write(LOG_DEBUG, ToString("UNDO: Save %d", _index));
-        }
+        UndoState state;
+        state.type = UndoState::STYLE_CHANGED;
+        state.style = style;
+        state.attributes = values;
+        if (PushState(state))
+            LogDebug("UNDO: Save style %d", _index);
+    }
+
+    /// Start collecting tracked states into a group that is undone and redone as a single change. Groups may nest,
+    /// states are pushed to undo stack when outermost group ends. Attribute changes inside a group that also moves
+    /// elements should be tracked before and after the change, like outside of groups.
+    void BeginGroup()
+    {
+        _group_depth++;
+    }
+
+    void EndGroup()
+    {
+        if (_group_depth == 0 || --_group_depth > 0)
+            return;
+
+        UndoState group;
+        group.type = UndoState::GROUP;
+        group.states = _group;
+        _group.Clear();
+        if (!group.states.Empty() && PushState(group))
+            LogDebug("UNDO: Save group %d of %d states", _index, group.states.Size());
     }
 
+    /// Track removal of `item`, call it before the element is removed. Removed subtree is kept alive only while it is
+    /// one of MAX_LIVE_REMOVALS recent removals, later undo rebuilds it from a snapshot.
     void TrackRemoval(UIElement* item)
     {
         TrackAddRemove(item, UndoState::UI_REMOVE);
@@ -164,60 +398,249 @@ public:
         TrackAddRemove(item, UndoState::UI_ADD);
     }
 
+    /// Return style attributes changed by last Undo(), Redo() or JumpTo(). Elements using them need to be restyled.
+    const Vector<StyleAttributeChange>& GetModifiedStyles() const { return _modified_styles; }
+
+    /// Forget all history and element ids.
+    void Clear()
+    {
+        _stack.Clear();
+        _nodes.Clear();
+        _num_branches = 0;
+        _index = -1;
+        _saved_index = -1;
+        _last_states.Clear();
+        _group.Clear();
+        _group_depth = 0;
+        _modified_styles.Clear();
+        _elements.Clear();
+        _element_ids.Clear();
+        _next_element_id = 1;
+        _live_removals.Clear();
+    }
+
+    /// Restore history of document under `root` from session file at `path`, or start a new session file when there
+    /// is none or it was saved with a different version of the document. `checksum` identifies document contents.
+    /// Style states are restored only when style file given to SetSessionStyle() is the one they were tracked in.
+    /// Return true if history was restored. Tracked states are appended to the file until CloseSession(). Session
+    /// file of a document without history is created when its first state is tracked.
+    bool OpenSession(const String& path, UIElement* root, unsigned checksum)
+    {
+        TraceZone trace_zone(GetSubsystem<TraceRecorder>(), "UndoManager::OpenSession", "io");
+        CloseSession();
+        Clear();
+
+        unsigned valid_size = 0;
+        unsigned file_size = 0;
+        if (LoadSession(path, root, checksum, valid_size, file_size))
+        {
+            // Record cut off by a crash is dropped together with everything after it.
+            if (valid_size < file_size)
+                WriteSessionFile(path, root, checksum);
+            else
+            {
+                _session = new File(context_, path, FILE_READWRITE);
+                if (_session->IsOpen())
+                {
+                    _session->Seek(file_size);
+                    _session_path = path;
+                }
+                else
+                    _session.Reset();
+            }
+            _saved_index = _index;
+            LogDebug("UNDO: Restored %u states from %s", _stack.Size(), path.CString());
+            return true;
+        }
+
+        Clear();
+        WriteSessionFile(path, root, checksum);
+        return false;
+    }
+
+    /// Record that document under `root` was saved with contents identified by `checksum`. History is written to a
+    /// new session file when document was saved to another path.
+    void SaveSession(const String& path, UIElement* root, unsigned checksum)
+    {
+        if (_session.NotNull() && path == _session_path)
+            WriteSavedRecord(root, checksum);
+        else
+            WriteSessionFile(path, root, checksum);
+    }
+
+    /// Set style file style states are tracked in, `path` is the file it was loaded from or saved to. Call it when
+    /// style file is loaded or saved.
+    void SetSessionStyle(XMLFile* style_file, const String& path)
+    {
+        _style_file = style_file;
+        _style_path = path;
+        // Checksum identifies contents of the file on disk, edits made since are not included.
+        _style_checksum = style_file != nullptr ? StringHash(style_file->ToString()).Value() : 0;
+        if (_session.NotNull())
+            WriteStyleRecord();
+    }
+
+    /// Stop writing history to session file. History itself is kept.
+    void CloseSession()
+    {
+        _session.Reset();
+        _session_path.Clear();
+        _pending_session_path.Clear();
+        _pending_saved_record.Clear();
+    }
+
+    /// Return session file belonging to layout, `Menu.xml` has `Menu.uisession` next to it.
+    static String GetSessionPath(const String& layout_path)
+    {
+        return GetPath(layout_path) + GetFileName(layout_path) + ".uisession";
+    }
+
     bool ApplyState(bool redo)
     {
-        const UndoState& state = _stack[_index];
+        TraceZone trace_zone(GetSubsystem<TraceRecorder>(), "UndoManager::ApplyState", "undo");
+        _snapshot_taken = false;
+        auto modified = ApplyState(_stack[_index], redo);
+        // Session file must hold the snapshot, element may be gone when history is restored.
+        if (_snapshot_taken && _session.NotNull())
+        {
+            VectorBuffer record;
+            record.WriteInt(_index);
+            WriteState(record, _stack[_index]);
+            WriteSessionRecord(SESSION_UPDATE, record);
+        }
+        return modified;
+    }
+
+    /// Number of removed subtrees kept alive for undo, older removals are rebuilt from snapshots.
+    static const unsigned MAX_LIVE_REMOVALS = 8;
+    static const unsigned SESSION_VERSION = 1;
+
+protected:
+    /// Session file is "UIUS" and SESSION_VERSION followed by records of kind, size and payload. Records are only
+    /// appended, so changes are written as they are made.
+    enum SessionRecord
+    {
+        /// Parent node, previous state and state that was pushed.
+        SESSION_STATE = 1,
+        /// Last state was removed by CompactTop().
+        SESSION_POP,
+        /// Index and state whose snapshot was taken again.
+        SESSION_UPDATE,
+        /// Document checksum, current state and ids of document elements in order of recursive children list.
+        SESSION_SAVED,
+        /// Path and checksum of style file that following style states were tracked in.
+        SESSION_STYLE,
+    };
+
+    bool ApplyState(UndoState& state, bool redo)
+    {
         bool modified = false;
         switch (state.type)
         {
         case UndoState::UI_ADD:
         case UndoState::UI_REMOVE:
         {
-            auto el = DynamicCast<UIElement>(state.item);
-            auto parent = DynamicCast<UIElement>(state.parent);
-            if ((state.type == UndoState::UI_ADD) ^ redo)
+            auto parent = GetElement(state.parent_id);
+            SharedPtr<UIElement> el(GetElement(state.item_id));
+            if (parent == nullptr)
+                LogDebug("UNDO: Skip state %d, parent does not exist", _index);
+            else if ((state.type == UndoState::UI_ADD) ^ redo)
             {
-                if (parent->GetChildren().Contains(el))
+                if (el.NotNull() && el->GetParent() == parent)
                 {
-                    DynamicCast<UIElement>(state.parent)->RemoveChild(el);
-                    context_->GetLog()->Write(LOG_DEBUG, ToString("UNDO: Add item state %d (%s)", _index,
-                                                                  redo ? "redo" : "undo"));
+                    // Element may have changed since it was tracked, snapshot holds its state at removal.
+                    TakeSnapshot(state, el);
+                    _snapshot_taken = true;
+                    KeepAlive(el);
+                    parent->RemoveChild(el);
+                    LogDebug("UNDO: Add item state %d (%s)", _index, redo ? "redo" : "undo");
                     modified = true;
                 }
                 else
-                    context_->GetLog()->Write(LOG_DEBUG, ToString("UNDO: Skip state %d", _index));
+                    LogDebug("UNDO: Skip state %d", _index);
             }
             else
             {
-                if (!parent->GetChildren().Contains(el))
+                if (el.Null() || el->GetParent() != parent)
                 {
-                    DynamicCast<UIElement>(state.parent)->InsertChild(state.index, el);
-                    context_->GetLog()->Write(LOG_DEBUG, ToString("UNDO: Del item state %d (%s)", _index,
-                                                                  redo ? "redo" : "undo"));
-                    modified = true;
+                    if (el.Null())
+                        el = RestoreSnapshot(state, parent);
+                    if (el.NotNull())
+                    {
+                        _live_removals.Remove(el);
+                        parent->InsertChild(state.index, el);
+                        LogDebug("UNDO: Del item state %d (%s)", _index, redo ? "redo" : "undo");
+                        modified = true;
+                    }
+                    else
+                        LogDebug("UNDO: Skip state %d, snapshot can not be restored", _index);
                 }
                 else
-                    context_->GetLog()->Write(LOG_DEBUG, ToString("UNDO: Skip state %d", _index));
+                    LogDebug("UNDO: Skip state %d", _index);
             }
             break;
         }
         case UndoState::ATTRIBUTE_CHANGED:
         {
+            auto item = GetItem(state);
+            if (item == nullptr)
+            {
+                LogDebug("UNDO: Skip state %d, item does not exist", _index);
+                break;
+            }
+
             for (auto it: state.attributes)
             {
-                if (state.item->GetAttribute(it.first_) != it.second_)
+                if (item->GetAttribute(it.first_) != it.second_)
                 {
-                    state.item->SetAttribute(it.first_, it.second_);
+                    item->SetAttribute(it.first_, it.second_);
                     modified = true;
                 }
             }
             if (modified)
             {
-                state.item->ApplyAttributes();
-                context_->GetLog()->Write(LOG_DEBUG, ToString("UNDO: Set state %d", _index));
+                item->ApplyAttributes();
+                CountProfilerEvent(FrameProfiler::COUNTER_APPLY_ATTRIBUTES);
+                LogDebug("UNDO: Set state %d", _index);
             }
             else
-                context_->GetLog()->Write(LOG_DEBUG, ToString("UNDO: Skip state %d", _index));
+                LogDebug("UNDO: Skip state %d", _index);
+            break;
+        }
+        case UndoState::STYLE_CHANGED:
+        {
+            // XMLElement is a handle, copy is needed for modifying the node.
+            auto style = state.style;
+            for (auto it: state.attributes)
+            {
+                auto attribute = GetStyleAttribute(style, it.first_);
+                auto old_value = attribute.IsNull() ? Variant() : Variant(attribute.GetAttribute("value"));
+                if (old_value == it.second_)
+                    continue;
+
+                if (!it.second_.IsEmpty())
+                    SetStyleAttribute(style, it.first_, it.second_.GetString());
+                else
+                    style.RemoveChild(attribute);
+                _modified_styles.Push(StyleAttributeChange{style, it.first_, old_value});
+                modified = true;
+            }
+            LogDebug(modified ? "UNDO: Set style state %d" : "UNDO: Skip state %d", _index);
+            break;
+        }
+        case UndoState::GROUP:
+        {
+            // Structural states depend on each other, undo applies them in reverse order.
+            if (redo)
+            {
+                for (auto& child_state: state.states)
+                    modified |= ApplyState(child_state, redo);
+            }
+            else
+            {
+                for (auto i = state.states.Size(); i-- > 0;)
+                    modified |= ApplyState(state.states[i], redo);
+            }
             break;
         }
         default:
@@ -227,29 +650,793 @@ public:
         return modified;
     }
 
-protected:
-
     void TrackAddRemove(UIElement* item, UndoState::Type type)
     {
         UndoState state;
         state.type = type;
         state.item = item;
-        state.parent = item->GetParent();
-        state.index = DynamicCast<UIElement>(state.parent)->GetChildren().IndexOf(SharedPtr<UIElement>(item));
-        _stack.Resize(++_index);
+        state.item_id = GetElementId(item);
+        state.parent_id = GetElementId(item->GetParent());
+        state.index = static_cast<unsigned>(GetChildIndex(item));
+        if (type == UndoState::UI_REMOVE)
+        {
+            TakeSnapshot(state, item);
+            KeepAlive(item);
+        }
+        if (PushState(state))
+            LogDebug("UNDO: Track item state %d (%s)", _index, type == UndoState::UI_ADD ? "add" : "del");
+    }
 
-        if (_stack.Size() > 0 && _stack.Back() == state)
+    /// Push state to undo stack, or to current group when one is open. Return true if state was added to undo stack.
+    /// States equal to current state are not added, undo and redo would skip them as no-ops. Equal states further
+    /// back are kept, they restore values that later changes of the same object overwrote.
+    bool PushState(UndoState& state)
+    {
+        state.hash = state.ComputeHash();
+        if (_group_depth > 0)
         {
-            context_->GetLog()->Write(LOG_DEBUG, "UNDO: Same value is already at the top of undo stack. Ignore.");
-            return;
+            _group.Push(state);
+            return false;
         }
 
+        if (_index >= 0 && _stack[_index] == state)
+        {
+            LogDebug("UNDO: Same value is already in undo history. Ignore.");
+            return false;
+        }
+
+        CompactTop();
+        state.previous = FindLastState(state.GetObjectKey());
+        AppendState(state, _index);
+        if (_session.Null() && !_pending_session_path.Empty())
+            CreatePendingSession();
+        if (_session.NotNull())
+        {
+            VectorBuffer record;
+            record.WriteInt(_nodes.Back().parent);
+            record.WriteInt(state.previous);
+            WriteState(record, state);
+            WriteSessionRecord(SESSION_STATE, record);
+        }
+        CountProfilerEvent(FrameProfiler::COUNTER_UNDO_PUSHES);
+        return true;
+    }
+
+    /// Add `state` to history as child of `parent` and make it current.
+    void AppendState(const UndoState& state, int parent)
+    {
+        AddNode(parent);
+        _index = _stack.Size();
+        if (state.type == UndoState::GROUP)
+        {
+            for (const auto& child_state: state.states)
+                _last_states[child_state.GetObjectKey()] = _index;
+        }
+        else
+            _last_states[state.GetObjectKey()] = _index;
         _stack.Push(state);
-        context_->GetLog()->Write(LOG_DEBUG, ToString("UNDO: Track item state %d (%s)", _index,
-                                                      type == UndoState::UI_ADD ? "add" : "del"));
     }
 
+    /// Add tree node of state that is about to be pushed as child of `parent`.
+    void AddNode(int parent)
+    {
+        UndoNode node;
+        node.parent = parent;
+        node.active_child = -1;
+        node.num_children = 0;
+        if (parent < 0)
+        {
+            node.jump = _nodes.Size();
+            node.depth = 0;
+            node.branch = _num_branches++;
+        }
+        else
+        {
+            auto& parent_node = _nodes[parent];
+            const auto& jump = _nodes[parent_node.jump];
+            node.jump = parent_node.depth - jump.depth == jump.depth - _nodes[jump.jump].depth ? jump.jump : parent;
+            node.depth = parent_node.depth + 1;
+            node.branch = parent_node.num_children == 0 ? parent_node.branch : _num_branches++;
+            parent_node.active_child = _nodes.Size();
+            parent_node.num_children++;
+        }
+        _nodes.Push(node);
+    }
+
+    /// Return ancestor of `node` at `depth`.
+    int FindAncestor(int node, unsigned depth) const
+    {
+        while (node >= 0 && _nodes[node].depth > depth)
+            node = _nodes[_nodes[node].jump].depth >= depth ? _nodes[node].jump : _nodes[node].parent;
+        return node;
+    }
+
+    int FindCommonAncestor(int a, int b) const
+    {
+        if (_nodes[a].depth > _nodes[b].depth)
+            a = FindAncestor(a, _nodes[b].depth);
+        else
+            b = FindAncestor(b, _nodes[a].depth);
+        // Nodes of the same depth have jumps of the same length.
+        while (a != b)
+        {
+            if (_nodes[a].jump != _nodes[b].jump)
+            {
+                a = _nodes[a].jump;
+                b = _nodes[b].jump;
+            }
+            else
+            {
+                a = _nodes[a].parent;
+                b = _nodes[b].parent;
+            }
+        }
+        return a;
+    }
+
+    /// Return index of last state of object with `key` on path from current state to the first state, or -1.
+    int FindLastState(unsigned long long key) const
+    {
+        auto it = _last_states.Find(key);
+        // Last state may be on another branch.
+        if (it == _last_states.End() || !IsOnCurrentPath(it->second_))
+            return -1;
+        const auto& state = _stack[it->second_];
+        if (state.type != UndoState::GROUP && state.GetObjectKey() != key)
+            return -1;
+        return it->second_;
+    }
+
+    /// Remove current state when it is the last added state, object still has the tracked values and previous state of
+    /// the object, if any, tracked the same values. Such state was tracked before a change that did not happen, like a
+    /// click that did not move the element. Without removal these states would accumulate and every undo step would
+    /// skip over them.
+    void CompactTop()
+    {
+        if (_index < 0 || _index != static_cast<int>(_stack.Size()) - 1 || _nodes[_index].num_children > 0)
+            return;
+
+        const auto& top = _stack.Back();
+        const auto& node = _nodes.Back();
+        if (top.type != UndoState::ATTRIBUTE_CHANGED || !top.Equals(GetItem(top)))
+            return;
+        // Otherwise undo of the state restores values that changed after previous state of the object.
+        if (top.previous >= 0)
+        {
+            auto previous = FindObjectState(_stack[top.previous], top.GetObjectKey());
+            if (previous == nullptr || !top.HasSameValues(*previous))
+                return;
+        }
+        // Redo of parent would lose its other branch.
+        if (node.parent >= 0 && _nodes[node.parent].num_children > 1)
+            return;
+
+        PopState();
+        if (_session.NotNull())
+            WriteSessionRecord(SESSION_POP, VectorBuffer());
+        LogDebug("UNDO: Remove no-op state %d", _stack.Size());
+    }
+
+    /// Return `state` when it belongs to object with `key`, or the last child state of group `state` that does.
+    static const UndoState* FindObjectState(const UndoState& state, unsigned long long key)
+    {
+        if (state.type != UndoState::GROUP)
+            return state.GetObjectKey() == key ? &state : nullptr;
+        for (auto i = state.states.Size(); i-- > 0;)
+        {
+            if (state.states[i].GetObjectKey() == key)
+                return &state.states[i];
+        }
+        return nullptr;
+    }
+
+    /// Remove last added state, it must be current state and have no children.
+    void PopState()
+    {
+        const auto& top = _stack.Back();
+        const auto& node = _nodes.Back();
+        if (node.parent >= 0)
+        {
+            _nodes[node.parent].active_child = -1;
+            _nodes[node.parent].num_children--;
+        }
+        else
+            _num_branches--;
+        // Removed state did not change anything, document is still in the state it was saved in.
+        if (_saved_index == _index)
+            _saved_index = node.parent;
+        _index = node.parent;
+        if (top.previous >= 0)
+            _last_states[top.GetObjectKey()] = top.previous;
+        else
+            _last_states.Erase(top.GetObjectKey());
+        _stack.Pop();
+        _nodes.Pop();
+    }
+
+    /// Return id of `element`, assigning a new one to elements that do not have it yet.
+    unsigned GetElementId(UIElement* element)
+    {
+        if (element == nullptr)
+            return 0;
+
+        auto id = FindElementId(element);
+        if (id == 0)
+        {
+            id = _next_element_id++;
+            _element_ids[element] = id;
+            _elements[id] = element;
+        }
+        return id;
+    }
+
+    /// Return id of `element` or zero when it does not have one.
+    unsigned FindElementId(UIElement* element) const
+    {
+        auto it = _element_ids.Find(element);
+        // Entry may belong to a destroyed element that had the same address.
+        if (it == _element_ids.End() || GetElement(it->second_) != element)
+            return 0;
+        return it->second_;
+    }
+
+    /// Return live element with `id`, or null when it was destroyed and not rebuilt yet.
+    UIElement* GetElement(unsigned id) const
+    {
+        auto it = _elements.Find(id);
+        return it == _elements.End() ? nullptr : it->second_.Get();
+    }
+
+    Serializable* GetItem(const UndoState& state) const
+    {
+        return state.item_id != 0 ? GetElement(state.item_id) : state.item.Get();
+    }
+
+    /// Save subtree of `element` to snapshot of `state`.
+    void TakeSnapshot(UndoState& state, UIElement* element)
+    {
+        AllocationScope allocation_scope("UndoManager");
+        state.snapshot.Clear();
+        state.snapshot_ids.Clear();
+
+        XMLFile xml(context_);
+        auto root = xml.CreateRoot("element");
+        if (!element->SaveXML(root))
+            return;
+        root.SetAttribute("type", element->GetTypeName());
+        VectorBuffer buffer;
+        if (!xml.Save(buffer, String::EMPTY))
+            return;
+        state.snapshot = CompressVectorBuffer(buffer);
+
+        if (auto id = FindElementId(element))
+            state.snapshot_ids.Push(MakePair(0u, id));
+        PODVector<UIElement*> children;
+        element->GetChildren(children, true);
+        for (unsigned i = 0; i < children.Size(); i++)
+        {
+            if (auto id = FindElementId(children[i]))
+                state.snapshot_ids.Push(MakePair(i + 1, id));
+        }
+    }
+
+    /// Create removed subtree from snapshot of `state` and give its elements their old ids. Element is not inserted.
+    SharedPtr<UIElement> RestoreSnapshot(const UndoState& state, UIElement* parent)
+    {
+        AllocationScope allocation_scope("UndoManager");
+        if (state.snapshot.GetSize() == 0)
+            return SharedPtr<UIElement>();
+
+        VectorBuffer compressed(state.snapshot.GetData(), state.snapshot.GetSize());
+        auto buffer = DecompressVectorBuffer(compressed);
+        XMLFile xml(context_);
+        if (!xml.Load(buffer))
+            return SharedPtr<UIElement>();
+
+        auto root = xml.GetRoot();
+        auto element = DynamicCast<UIElement>(context_->CreateObject(StringHash(root.GetAttribute("type"))));
+        if (element.Null() || !element->LoadXML(root, parent->GetDefaultStyle()))
+            return SharedPtr<UIElement>();
+
+        PODVector<UIElement*> children;
+        element->GetChildren(children, true);
+        for (const auto& it: state.snapshot_ids)
+        {
+            auto rebuilt = it.first_ == 0 ? element.Get() : it.first_ <= children.Size() ? children[it.first_ - 1] :
+                           nullptr;
+            if (rebuilt == nullptr)
+                continue;
+            _elements[it.second_] = rebuilt;
+            _element_ids[rebuilt] = it.second_;
+        }
+        LogDebug("UNDO: Rebuilt %s from %u byte snapshot", element->GetTypeName().CString(), state.snapshot.GetSize());
+        return element;
+    }
+
+    /// Keep removed `element` alive as most recent removal, dropping oldest ones over MAX_LIVE_REMOVALS.
+    void KeepAlive(UIElement* element)
+    {
+        SharedPtr<UIElement> removed(element);
+        _live_removals.Remove(removed);
+        _live_removals.Push(removed);
+        if (_live_removals.Size() > MAX_LIVE_REMOVALS)
+            _live_removals.Erase(0);
+    }
+
+    /// Read session file into empty history. Return false when file is missing or invalid, or when document under
+    /// `root` is not the one saved last. `valid_size` receives size of complete records.
+    bool LoadSession(const String& path, UIElement* root, unsigned checksum, unsigned& valid_size,
+                     unsigned& file_size)
+    {
+        MappedFile mapped;
+        if (!mapped.Open(context_, path))
+            return false;
+
+        MemoryBuffer buffer(mapped.GetData(), mapped.GetSize());
+        if (buffer.ReadFileID() != "UIUS" || buffer.ReadUInt() != SESSION_VERSION)
+            return false;
+
+        // Style states resolve against open style file only while records belong to it.
+        XMLElement style_root;
+        auto style_valid = false;
+        auto saved = false;
+        unsigned saved_checksum = 0;
+        int saved_index = -1;
+        PODVector<unsigned> saved_ids;
+        valid_size = buffer.GetPosition();
+        file_size = buffer.GetSize();
+        while (!buffer.IsEof())
+        {
+            auto kind = buffer.ReadUByte();
+            auto size = buffer.ReadVLE();
+            if (size > buffer.GetSize() - buffer.GetPosition())
+                break;
+            MemoryBuffer record(mapped.GetData() + buffer.GetPosition(), size);
+            buffer.Seek(buffer.GetPosition() + size);
+
+            if (kind == SESSION_STATE)
+            {
+                auto parent = record.ReadInt();
+                UndoState state;
+                state.previous = record.ReadInt();
+                if (parent < -1 || parent >= static_cast<int>(_stack.Size()) || !ReadState(record, state, style_root))
+                    break;
+                AppendState(state, parent);
+            }
+            else if (kind == SESSION_POP)
+            {
+                if (_stack.Empty() || _index != static_cast<int>(_stack.Size()) - 1 || _nodes.Back().num_children > 0)
+                    break;
+                PopState();
+            }
+            else if (kind == SESSION_UPDATE)
+            {
+                auto index = record.ReadInt();
+                UndoState state;
+                if (index < 0 || index >= static_cast<int>(_stack.Size()) || !ReadState(record, state, style_root))
+                    break;
+                state.previous = _stack[index].previous;
+                _stack[index] = state;
+            }
+            else if (kind == SESSION_STYLE)
+            {
+                auto style_path = record.ReadString();
+                auto style_checksum = record.ReadUInt();
+                style_valid = _style_file.NotNull() && style_path == _style_path && style_checksum == _style_checksum;
+                style_root = _style_file.NotNull() && style_path == _style_path ? _style_file->GetRoot() : XMLElement();
+            }
+            else if (kind == SESSION_SAVED)
+            {
+                saved = true;
+                saved_checksum = record.ReadUInt();
+                saved_index = record.ReadInt();
+                auto num_ids = record.ReadVLE();
+                if (num_ids > record.GetSize())
+                    break;
+                saved_ids.Resize(num_ids);
+                for (auto& id: saved_ids)
+                    id = record.ReadVLE();
+            }
+            else
+                break;
+            valid_size = buffer.GetPosition();
+        }
+
+        // Document was edited outside of the editor after it was saved last.
+        if (!saved || saved_checksum != checksum || saved_index >= static_cast<int>(_stack.Size()))
+            return false;
+        PODVector<UIElement*> elements;
+        CollectElements(root, elements);
+        if (elements.Size() != saved_ids.Size())
+            return false;
+
+        // Style file was changed outside of the editor since states were tracked, their paths may point elsewhere.
+        if (!style_valid)
+        {
+            for (auto& state: _stack)
+                InvalidateStyleStates(state);
+        }
+
+        for (unsigned i = 0; i < elements.Size(); i++)
+        {
+            _elements[saved_ids[i]] = elements[i];
+            _element_ids[elements[i]] = saved_ids[i];
+            NoteElementId(saved_ids[i]);
+        }
+        _index = saved_index;
+        // Redo continues along the branch that was current when document was saved.
+        for (auto i = _index; i >= 0 && _nodes[i].parent >= 0; i = _nodes[i].parent)
+            _nodes[_nodes[i].parent].active_child = i;
+        return true;
+    }
+
+    /// Write whole history to a new session file at `path` and keep appending to it.
+    void WriteSessionFile(const String& path, UIElement* root, unsigned checksum)
+    {
+        CloseSession();
+        // Browsing documents must not leave session files next to them. Saved record is taken now, document may
+        // change before the first state is tracked.
+        if (_stack.Empty())
+        {
+            _pending_session_path = path;
+            _pending_saved_record = GetSavedRecord(root, checksum);
+            return;
+        }
+
+        if (!CreateSessionFile(path))
+            return;
+        for (unsigned i = 0; i < _stack.Size(); i++)
+        {
+            VectorBuffer record;
+            record.WriteInt(_nodes[i].parent);
+            record.WriteInt(_stack[i].previous);
+            WriteState(record, _stack[i]);
+            WriteSessionRecord(SESSION_STATE, record);
+        }
+        WriteSavedRecord(root, checksum);
+    }
+
+    /// Create session file at `path` and write its header and current style. Return false if file can not be created.
+    bool CreateSessionFile(const String& path)
+    {
+        _session = new File(context_, path, FILE_WRITE);
+        if (!_session->IsOpen())
+        {
+            _session.Reset();
+            return false;
+        }
+
+        _session_path = path;
+        _session->WriteFileID("UIUS");
+        _session->WriteUInt(SESSION_VERSION);
+        WriteStyleRecord();
+        return true;
+    }
+
+    /// Create session file deferred by WriteSessionFile() when the first state is tracked.
+    void CreatePendingSession()
+    {
+        if (CreateSessionFile(_pending_session_path))
+            WriteSessionRecord(SESSION_SAVED, _pending_saved_record);
+        _pending_session_path.Clear();
+        _pending_saved_record.Clear();
+    }
+
+    /// Write ids of all elements under `root`, they map states to elements of saved document when it is reopened.
+    void WriteSavedRecord(UIElement* root, unsigned checksum)
+    {
+        WriteSessionRecord(SESSION_SAVED, GetSavedRecord(root, checksum));
+    }
+
+    VectorBuffer GetSavedRecord(UIElement* root, unsigned checksum)
+    {
+        PODVector<UIElement*> elements;
+        CollectElements(root, elements);
+        VectorBuffer record;
+        record.WriteUInt(checksum);
+        record.WriteInt(_index);
+        record.WriteVLE(elements.Size());
+        for (auto element: elements)
+            record.WriteVLE(GetElementId(element));
+        return record;
+    }
+
+    void WriteStyleRecord()
+    {
+        VectorBuffer record;
+        record.WriteString(_style_path);
+        record.WriteUInt(_style_checksum);
+        WriteSessionRecord(SESSION_STYLE, record);
+    }
+
+    /// Turn style states of `state` into invalid states, they are skipped by undo and redo.
+    static void InvalidateStyleStates(UndoState& state)
+    {
+        if (state.type == UndoState::STYLE_CHANGED)
+        {
+            state.type = UndoState::INVALID_STATE;
+            state.style = XMLElement();
+        }
+        else if (state.type == UndoState::GROUP)
+        {
+            for (auto& child_state: state.states)
+                InvalidateStyleStates(child_state);
+        }
+        else
+            return;
+        state.hash = state.ComputeHash();
+    }
+
+    /// Append record to session file. File is flushed, so a crash loses at most the record being written.
+    void WriteSessionRecord(SessionRecord kind, const VectorBuffer& record)
+    {
+        _session->WriteUByte(static_cast<unsigned char>(kind));
+        _session->WriteVLE(record.GetSize());
+        _session->Write(record.GetData(), record.GetSize());
+        _session->Flush();
+    }
+
+    /// Write `state` in compact form. Element attributes are indices into attribute list of element type followed by
+    /// typed values, structural changes are ids and compressed snapshots. States of objects that are not elements
+    /// can not be found again and are written as invalid.
+    void WriteState(Serializer& dest, const UndoState& state) const
+    {
+        auto type = state.type;
+        if (type == UndoState::ATTRIBUTE_CHANGED && state.item_id == 0)
+            type = UndoState::INVALID_STATE;
+        // Style states of previously open style files can not be resolved in current one.
+        if (type == UndoState::STYLE_CHANGED && (_style_file.Null() || state.style.GetFile() != _style_file.Get()))
+            type = UndoState::INVALID_STATE;
+        dest.WriteUByte(static_cast<unsigned char>(type));
+
+        switch (type)
+        {
+        case UndoState::ATTRIBUTE_CHANGED:
+            dest.WriteVLE(state.item_id);
+            dest.WriteStringHash(state.item_type);
+            WriteAttributes(dest, state.attributes, context_->GetAttributes(state.item_type));
+            break;
+        case UndoState::STYLE_CHANGED:
+            WriteStylePath(dest, state.style);
+            WriteAttributes(dest, state.attributes, nullptr);
+            break;
+        case UndoState::UI_ADD:
+        case UndoState::UI_REMOVE:
+            dest.WriteVLE(state.item_id);
+            dest.WriteVLE(state.parent_id);
+            dest.WriteVLE(state.index);
+            dest.WriteVLE(state.snapshot.GetSize());
+            dest.Write(state.snapshot.GetData(), state.snapshot.GetSize());
+            dest.WriteVLE(state.snapshot_ids.Size());
+            for (const auto& it: state.snapshot_ids)
+            {
+                dest.WriteVLE(it.first_);
+                dest.WriteVLE(it.second_);
+            }
+            break;
+        case UndoState::GROUP:
+            dest.WriteVLE(state.states.Size());
+            for (const auto& child_state: state.states)
+                WriteState(dest, child_state);
+            break;
+        default:
+            break;
+        }
+    }
+
+    /// Read state written by WriteState(). Return false when data is corrupted.
+    bool ReadState(Deserializer& source, UndoState& state, const XMLElement& style_root)
+    {
+        state.type = static_cast<UndoState::Type>(source.ReadUByte());
+        switch (state.type)
+        {
+        case UndoState::ATTRIBUTE_CHANGED:
+            state.item_id = source.ReadVLE();
+            state.item_type = source.ReadStringHash();
+            NoteElementId(state.item_id);
+            if (!ReadAttributes(source, state.attributes, context_->GetAttributes(state.item_type)))
+                return false;
+            break;
+        case UndoState::STYLE_CHANGED:
+            state.style = ReadStylePath(source, style_root);
+            if (!ReadAttributes(source, state.attributes, nullptr))
+                return false;
+            // Style file the state was tracked in is not loaded.
+            if (state.style.IsNull())
+                state.type = UndoState::INVALID_STATE;
+            break;
+        case UndoState::UI_ADD:
+        case UndoState::UI_REMOVE:
+        {
+            state.item_id = source.ReadVLE();
+            state.parent_id = source.ReadVLE();
+            state.index = source.ReadVLE();
+            NoteElementId(state.item_id);
+            NoteElementId(state.parent_id);
+            auto size = source.ReadVLE();
+            if (size > source.GetSize() - source.GetPosition())
+                return false;
+            state.snapshot.SetData(source, size);
+            auto num_ids = source.ReadVLE();
+            if (num_ids > source.GetSize())
+                return false;
+            for (unsigned i = 0; i < num_ids; i++)
+            {
+                auto position = source.ReadVLE();
+                auto id = source.ReadVLE();
+                state.snapshot_ids.Push(MakePair(position, id));
+                NoteElementId(id);
+            }
+            break;
+        }
+        case UndoState::GROUP:
+        {
+            auto count = source.ReadVLE();
+            if (count > source.GetSize())
+                return false;
+            state.states.Resize(count);
+            for (auto& child_state: state.states)
+            {
+                if (!ReadState(source, child_state, style_root))
+                    return false;
+            }
+            break;
+        }
+        case UndoState::INVALID_STATE:
+            break;
+        default:
+            return false;
+        }
+        state.hash = state.ComputeHash();
+        return true;
+    }
+
+    /// Write attributes as index into `infos` plus one, or zero followed by name when attribute is not in `infos`.
+    static void WriteAttributes(Serializer& dest, const HashMap<String, Variant>& attributes,
+                                const Vector<AttributeInfo>* infos)
+    {
+        dest.WriteVLE(attributes.Size());
+        for (const auto& it: attributes)
+        {
+            unsigned index = 0;
+            for (unsigned i = 0; infos != nullptr && i < infos->Size() && index == 0; i++)
+            {
+                if (infos->At(i).name_ == it.first_)
+                    index = i + 1;
+            }
+            dest.WriteVLE(index);
+            if (index == 0)
+                dest.WriteString(it.first_);
+            dest.WriteVariant(it.second_);
+        }
+    }
+
+    static bool ReadAttributes(Deserializer& source, HashMap<String, Variant>& attributes,
+                               const Vector<AttributeInfo>* infos)
+    {
+        auto count = source.ReadVLE();
+        if (count > source.GetSize())
+            return false;
+        for (unsigned i = 0; i < count; i++)
+        {
+            auto index = source.ReadVLE();
+            String name;
+            if (index == 0)
+                name = source.ReadString();
+            else if (infos != nullptr && index <= infos->Size())
+                name = infos->At(index - 1).name_;
+            else
+                return false;
+            attributes[name] = source.ReadVariant();
+        }
+        return true;
+    }
+
+    /// Write position of style element as indices among `<element>` siblings, from top level style down.
+    static void WriteStylePath(Serializer& dest, XMLElement style)
+    {
+        PODVector<unsigned> path;
+        for (;;)
+        {
+            auto parent = style.GetParent();
+            unsigned index = 0;
+            for (auto sibling = parent.GetChild("element"); sibling.NotNull() && sibling.GetNode() != style.GetNode();
+                 sibling = sibling.GetNext("element"))
+                index++;
+            path.Push(index);
+            if (parent.GetName() != "element")
+                break;
+            style = parent;
+        }
+        dest.WriteVLE(path.Size());
+        for (auto i = path.Size(); i-- > 0;)
+            dest.WriteVLE(path[i]);
+    }
+
+    /// Return style element at path written by WriteStylePath(), or null when style file has no such element.
+    static XMLElement ReadStylePath(Deserializer& source, const XMLElement& style_root)
+    {
+        auto length = source.ReadVLE();
+        if (length == 0 || length > source.GetSize())
+            return XMLElement();
+
+        auto style = style_root;
+        for (unsigned i = 0; i < length; i++)
+        {
+            auto index = source.ReadVLE();
+            style = style.GetChild("element");
+            for (; index > 0 && style.NotNull(); index--)
+                style = style.GetNext("element");
+        }
+        return style;
+    }
+
+    /// Collect `root` followed by all elements below it in order of recursive children list.
+    static void CollectElements(UIElement* root, PODVector<UIElement*>& elements)
+    {
+        root->GetChildren(elements, true);
+        elements.Insert(0, root);
+    }
+
+    /// Make sure new ids do not reuse `id` read from session file.
+    void NoteElementId(unsigned id)
+    {
+        _next_element_id = Max(_next_element_id, id + 1);
+    }
+
+    bool IsLoggingDebug() const
+    {
+        auto log = context_->GetLog();
+        return log != nullptr && log->GetLevel() <= LOG_DEBUG;
+    }
+
+    /// Format and write a debug message. Formatting is skipped when message would be filtered out by log level.
+    template<typename... Args>
+    void LogDebug(const char* format, Args... args)
+    {
+        if (IsLoggingDebug())
+            context_->GetLog()->Write(LOG_DEBUG, ToString(format, args...));
+    }
+
+    void CountProfilerEvent(FrameProfiler::Counter counter)
+    {
+        if (auto profiler = GetSubsystem<FrameProfiler>())
+            profiler->Count(counter);
+    }
+
+    /// States in the order they were tracked, `_nodes` has their position in history tree.
     Vector<UndoState> _stack;
+    PODVector<UndoNode> _nodes;
+    unsigned _num_branches = 0;
+    /// Current state.
     int32_t _index = -1;
+    /// State document was loaded or last saved in.
+    int32_t _saved_index = -1;
+    /// Object key -> index of its last tracked state, which may be on another branch.
+    HashMap<unsigned long long, int> _last_states;
+    /// States tracked since outermost BeginGroup().
+    Vector<UndoState> _group;
+    unsigned _group_depth = 0;
+    /// Style attributes changed by last Undo(), Redo() or JumpTo().
+    Vector<StyleAttributeChange> _modified_styles;
+    /// Element id -> element, rebuilt elements replace destroyed ones.
+    HashMap<unsigned, WeakPtr<UIElement>> _elements;
+    /// Element -> its id. Entries of destroyed elements are stale, FindElementId() ignores them.
+    HashMap<UIElement*, unsigned> _element_ids;
+    unsigned _next_element_id = 1;
+    /// Recently removed subtrees, most recent last.
+    Vector<SharedPtr<UIElement>> _live_removals;
+    /// Session file tracked states are appended to, null when history is not saved.
+    SharedPtr<File> _session;
+    String _session_path;
+    /// Session file to create when the first state is tracked, with saved record of the document.
+    String _pending_session_path;
+    VectorBuffer _pending_saved_record;
+    /// Style file style states are tracked in, with its path and checksum of its contents on disk.
+    WeakPtr<XMLFile> _style_file;
+    String _style_path;
+    unsigned _style_checksum = 0;
+    /// Set when ApplyState() takes a snapshot of an element it removes.
+    bool _snapshot_taken = false;
 
 };
\ No newline at end of file
@@ -0,0 +1,76 @@
+#pragma once
+
+
+#include <Atomic/Container/Str.h>
+#include <Atomic/Container/Vector.h>
+
+#include <cstdio>
+
+using namespace Atomic;
+
+
+/// Child process started through a shell, its stdout is read through a pipe.
+class WorkerProcess
+{
+public:
+    WorkerProcess() = default;
+    WorkerProcess(const WorkerProcess&) = delete;
+    WorkerProcess& operator=(const WorkerProcess&) = delete;
+    ~WorkerProcess() { Wait(); }
+
+    /// Start `program` with `arguments`. Arguments are quoted for the shell.
+    bool Start(const String& program, const Vector<String>& arguments)
+    {
+        auto command_line = QuoteArgument(program);
+        for (const auto& argument: arguments)
+            command_line += " " + QuoteArgument(argument);
+#if defined(_WIN32)
+        // cmd.exe strips outer quotes of a command line that starts with a quote.
+        _pipe = _popen(("\"" + command_line + "\"").CString(), "r");
+#else
+        _pipe = popen(command_line.CString(), "r");
+#endif
+        return _pipe != nullptr;
+    }
+
+    /// Read stdout of process until it closes it.
+    String ReadOutput()
+    {
+        String output;
+        char buffer[4096];
+        while (_pipe != nullptr)
+        {
+            auto size = fread(buffer, 1, sizeof(buffer), _pipe);
+            if (size == 0)
+                break;
+            output.Append(buffer, static_cast<unsigned>(size));
+        }
+        return output;
+    }
+
+    /// Wait for process to exit and return true if it exited with zero status.
+    bool Wait()
+    {
+        if (_pipe == nullptr)
+            return false;
+#if defined(_WIN32)
+        auto status = _pclose(_pipe);
+#else
+        auto status = pclose(_pipe);
+#endif
+        _pipe = nullptr;
+        return status == 0;
+    }
+
+    static String QuoteArgument(const String& argument)
+    {
+#if defined(_WIN32)
+        return "\"" + argument.Replaced("\"", "\\\"") + "\"";
+#else
+        return "'" + argument.Replaced("'", "'\\''") + "'";
+#endif
+    }
+
+protected:
+    FILE* _pipe = nullptr;
+};
@@ -0,0 +1,170 @@
+#pragma once
+
+
+#include <Atomic/Container/Str.h>
+#include <Atomic/Container/Vector.h>
+
+#include <cctype>
+#include <cstring>
+
+using namespace Atomic;
+
+
+/// Attribute of XML start tag seen by RewriteXMLAttributes().
+struct XMLTagAttribute
+{
+    String name;
+    /// Value with entities decoded.
+    String value;
+    /// Original text of attribute including leading whitespace, empty for added attributes.
+    String raw;
+    /// Set when value is modified or attribute is added, then it is written as `name="value"`.
+    bool changed = false;
+};
+
+/// Decode predefined XML entities.
+inline String DecodeXMLEntities(const String& value)
+{
+    if (!value.Contains('&'))
+        return value;
+    return value.Replaced("&quot;", "\"").Replaced("&apos;", "'").Replaced("&lt;", "<").Replaced("&gt;", ">")
+        .Replaced("&amp;", "&");
+}
+
+inline String EncodeXMLEntities(const String& value)
+{
+    return value.Replaced("&", "&amp;").Replaced("<", "&lt;").Replaced(">", "&gt;").Replaced("\"", "&quot;");
+}
+
+/// Copy XML text from `input` to `output` in a single pass without building DOM. `visitor` is called for every start
+/// tag as `unsigned visitor(const String& tag, unsigned depth, Vector<XMLTagAttribute>& attributes)` and returns
+/// number of changes it made. Only tags with changes are written again, everything else including formatting and
+/// comments is copied byte for byte. Return total number of changes, malformed remainder of input is copied as is.
+template<typename Visitor>
+unsigned RewriteXMLAttributes(const String& input, String& output, Visitor visitor)
+{
+    const auto* text = input.CString();
+    auto length = input.Length();
+    unsigned changes = 0;
+    unsigned depth = 0;
+    unsigned pos = 0;
+    Vector<XMLTagAttribute> attributes;
+
+    output.Clear();
+    output.Reserve(length);
+    while (pos < length)
+    {
+        auto start = input.Find('<', pos);
+        if (start == String::NPOS)
+            break;
+        output.Append(text + pos, start - pos);
+        pos = start;
+
+        // Markup that has no attributes is copied up to its terminator.
+        const char* terminator = nullptr;
+        if (input.Substring(pos, 4) == "<!--")
+            terminator = "-->";
+        else if (input.Substring(pos, 9) == "<![CDATA[")
+            terminator = "]]>";
+        else if (input.Substring(pos, 2) == "<?")
+            terminator = "?>";
+        else if (input.Substring(pos, 2) == "<!" || input.Substring(pos, 2) == "</")
+            terminator = ">";
+        if (terminator != nullptr)
+        {
+            auto end = input.Find(terminator, pos + 1);
+            if (end == String::NPOS)
+                break;
+            end += static_cast<unsigned>(strlen(terminator));
+            if (text[pos + 1] == '/' && depth > 0)
+                depth--;
+            output.Append(text + pos, end - pos);
+            pos = end;
+            continue;
+        }
+
+        // Start tag.
+        auto i = pos + 1;
+        while (i < length && !isspace(static_cast<unsigned char>(text[i])) && text[i] != '/' && text[i] != '>')
+            i++;
+        String tag(text + pos + 1, i - pos - 1);
+
+        attributes.Clear();
+        auto malformed = false;
+        for (;;)
+        {
+            auto j = i;
+            while (j < length && isspace(static_cast<unsigned char>(text[j])))
+                j++;
+            if (j >= length || text[j] == '/' || text[j] == '>')
+                break;
+
+            auto name_start = j;
+            while (j < length && text[j] != '=' && !isspace(static_cast<unsigned char>(text[j])))
+                j++;
+            auto name_end = j;
+            while (j < length && isspace(static_cast<unsigned char>(text[j])))
+                j++;
+            if (j >= length || text[j] != '=')
+            {
+                malformed = true;
+                break;
+            }
+            j++;
+            while (j < length && isspace(static_cast<unsigned char>(text[j])))
+                j++;
+            if (j >= length || (text[j] != '"' && text[j] != '\''))
+            {
+                malformed = true;
+                break;
+            }
+            auto quote = text[j];
+            auto value_start = ++j;
+            while (j < length && text[j] != quote)
+                j++;
+            if (j >= length)
+            {
+                malformed = true;
+                break;
+            }
+
+            XMLTagAttribute attribute;
+            attribute.name = String(text + name_start, name_end - name_start);
+            attribute.value = DecodeXMLEntities(String(text + value_start, j - value_start));
+            attribute.raw = String(text + i, j + 1 - i);
+            attributes.Push(attribute);
+            i = j + 1;
+        }
+
+        auto end = malformed ? String::NPOS : input.Find('>', i);
+        if (end == String::NPOS)
+            break;
+        end++;
+        auto self_closing = text[end - 2] == '/';
+
+        auto tag_changes = visitor(tag, depth, attributes);
+        if (tag_changes > 0)
+        {
+            changes += tag_changes;
+            output += "<" + tag;
+            for (const auto& attribute: attributes)
+            {
+                if (attribute.changed)
+                    output += " " + attribute.name + "=\"" + EncodeXMLEntities(attribute.value) + "\"";
+                else
+                    output += attribute.raw;
+            }
+            output.Append(text + i, end - i);
+        }
+        else
+            output.Append(text + pos, end - pos);
+
+        if (!self_closing)
+            depth++;
+        pos = end;
+    }
+
+    if (pos < length)
+        output.Append(text + pos, length - pos);
+    return changes;
+}
@@ -15,13 +15,41 @@
 #include <Atomic/IO/Log.h>
 #include <Atomic/Graphics/GraphicsEvents.h>
 #include <Atomic/Core/CoreEvents.h>
+#include <Atomic/Core/ProcessUtils.h>
+#include <Atomic/Core/Timer.h>
+#include <Atomic/IO/MemoryBuffer.h>
+#include <Atomic/IO/VectorBuffer.h>
+#include <Atomic/Resource/JSONFile.h>
 
 #include <UrhoUI.h>
 #include <unordered_map>
 #include <array>
+#include <memory>
+#include <vector>
 #include <tinyfiledialogs.h>
 #include "IconsFontAwesome.h"
 #include "UndoManager.hpp"
+#include "AllocationTracker.hpp"
+#include "CommandChannel.hpp"
+#include "EditBuffers.hpp"
+#include "ElementUtils.hpp"
+#include "FrameArena.hpp"
+#include "FrameProfiler.hpp"
+#include "InputRecorder.hpp"
+#include "LayoutBudget.hpp"
+#include "LayoutCodeGenerator.hpp"
+#include "LayoutGenerator.hpp"
+#include "LayoutMinifier.hpp"
+#include "LayoutOptimizer.hpp"
+#include "OverdrawAnalyzer.hpp"
+#include "ProjectIndex.hpp"
+#include "ProjectRename.hpp"
+#include "RenderCostAnalyzer.hpp"
+#include "StyleIndex.hpp"
+#include "StyleUsageAnalyzer.hpp"
+#include "TextureAtlasPacker.hpp"
+#include "TraceRecorder.hpp"
+#include "WorkerProcess.hpp"
 
 
 using namespace std::placeholders;
@@ -65,41 +93,216 @@ public:
     WeakPtr<UIElement> _selected;
     WeakPtr<DebugRenderer> _debug;
     WeakPtr<Camera> _camera;
-    HashMap<String, std::array<char, 0x1000>> _buffers;
+    WeakPtr<FrameProfiler> _profiler;
+    WeakPtr<TraceRecorder> _trace;
+    EditBuffers _edit_buffers;
     UndoManager _undo;
     String _current_file_path;
     String _current_style_file_path;
     bool _is_editing_value = false;
     bool _show_internal = false;
-    bool _clear_buffers = true;
     ResizeType _resizing = RESIZE_NONE;
-    std::array<char, 0x100> _filter;
+    std::array<char, 0x100> _filter{};
     SharedPtr<XMLFile> _style_file;
+    /// Elements of current layout by styles they use, restyles them when styles change.
+    StyleIndex _style_index;
     Vector<String> _style_names;
     HashMap<ResizeType, SDL_Cursor*> cursors;
     SDL_Cursor* cursor_arrow;
     bool _hide_resize_handles = false;
+    bool _show_profiler = false;
+    HashMap<String, Variant> _tracked_geometry;
+    /// Storage for strings and buffers needed only during current frame.
+    FrameArena _frame_arena;
+    bool _show_render_cost = false;
+    bool _auto_refresh_render_cost = false;
+    RenderCostAnalyzer _render_cost;
+    bool _show_overdraw = false;
+    OverdrawAnalyzer _overdraw;
+    TextureAtlasPacker _atlas_packer;
+    /// Values style attributes had before they were pointed to texture atlas, keyed by `<attribute>` node.
+    HashMap<pugi::xml_node_struct*, String> _atlas_style_values;
+    LayoutMinifier _minifier;
+    LayoutOptimizer _optimizer;
+    bool _show_optimizer_report = false;
+    LayoutCodeGenerator _code_generator;
+    StyleUsageAnalyzer _style_usage;
+    bool _show_style_usage = false;
+    ProjectIndex _project_index;
+    bool _show_project_index = false;
+    int _index_query_type = QUERY_STYLE;
+    std::array<char, 0x100> _index_query{};
+    Vector<String> _index_results;
+    ProjectRename _rename;
+    bool _show_rename = false;
+    /// Rename was started from the editor and its results were not handled yet.
+    bool _rename_pending = false;
+    /// Open layout and style that rename did not rewrite.
+    Vector<String> _rename_skipped;
+    int _rename_kind = RENAME_STYLE;
+    std::array<char, 0x100> _rename_from{};
+    std::array<char, 0x100> _rename_to{};
+    LayoutGenerator _generator;
+    LayoutGeneratorSettings _generator_settings;
+    bool _show_generator = false;
+    bool _show_undo_history = false;
+    std::array<char, 0x100> _generator_types{};
+    /// Remove attributes equal to style or default values when saving layout.
+    bool _minify_on_save = false;
+    /// Result of last operation, shown in main menu bar.
+    String _status_message;
+    /// Budget limits exceeded by last saved layout, shown in main menu bar.
+    String _budget_warning;
+    /// Files passed on command line.
+    Vector<String> _input_files;
+    /// Trace file requested on command line.
+    String _trace_file_path;
+    /// Command executed by headless batch mode, empty when editor runs interactively.
+    String _batch_command;
+    /// `--name=value` options passed on command line.
+    HashMap<String, String> _options;
+    /// Server mode is active.
+    bool _serve = false;
+    /// UNIX socket server mode listens on, empty when requests come from stdin.
+    String _serve_socket_path;
+    /// Source of viewport input, records editor sessions and replays them.
+    InputRecorder _recorder;
+    /// Recording replayed headlessly, empty when editor runs interactively.
+    String _replay_path;
+    HiresTimer _replay_frame_timer;
+    PODVector<float> _replay_frame_times;
 
     explicit UIEditorApplication(Context* ctx)
         : Application(ctx)
         , _undo(ctx)
+        , _style_index(ctx)
+        , _atlas_packer(ctx)
+        , _minifier(ctx)
+        , _code_generator(ctx)
+        , _style_usage(ctx)
+        , _project_index(ctx)
+        , _rename(ctx)
+        , _recorder(ctx)
     {
     }
 
     void Setup() override
     {
+        ParseCommandLine();
+
         engineParameters_[EP_WINDOW_TITLE] = GetTypeName();
-        engineParameters_[EP_HEADLESS] = false;
+        engineParameters_[EP_HEADLESS] = IsBatchMode();
         engineParameters_[EP_RESOURCE_PATHS] = "CoreData;UIEditorData";
         engineParameters_[EP_RESOURCE_PREFIX_PATHS] = context_->GetFileSystem()->GetProgramDir();
         engineParameters_[EP_FULL_SCREEN] = false;
         engineParameters_[EP_WINDOW_HEIGHT] = 1080;
         engineParameters_[EP_WINDOW_WIDTH] = 1920;
-        engineParameters_[EP_LOG_LEVEL] = LOG_DEBUG;
+        // Batch mode writes its report to stdout, keep it clean.
+        engineParameters_[EP_LOG_LEVEL] = IsBatchMode() ? LOG_ERROR : LOG_DEBUG;
+    }
+
+    /// Parse `--batch=<command>`, `--replay=<file>`, `--trace[=file.json]`, other `--name=value` options and input
+    /// files. Arguments starting with a single dash belong to the engine.
+    void ParseCommandLine()
+    {
+        const auto& arguments = GetArguments();
+        for (auto i = 0; i < arguments.Size(); i++)
+        {
+            const auto& arg = arguments[i];
+            if (arg.StartsWith("--"))
+            {
+                auto separator = arg.Find('=');
+                auto name = arg.Substring(2, separator == String::NPOS ? String::NPOS : separator - 2);
+                auto value = separator == String::NPOS ? String("true") : arg.Substring(separator + 1);
+
+                if (name == "batch")
+                    _batch_command = value;
+                else if (name == "replay")
+                    _replay_path = GetAbsoluteFilePath(value);
+                else if (name == "serve")
+                {
+                    _serve = true;
+                    if (separator != String::NPOS)
+                        _serve_socket_path = value;
+                }
+                else if (name == "trace")
+                {
+                    // Trace file path may also follow the flag as a separate argument.
+                    if (separator != String::NPOS)
+                        _trace_file_path = value;
+                    else if (i + 1 < arguments.Size() && arguments[i + 1].EndsWith(".json", false))
+                        _trace_file_path = arguments[++i];
+                    else
+                        _trace_file_path = "trace.json";
+                }
+                else
+                    _options[name] = value;
+            }
+            else if (!arg.StartsWith("-"))
+                _input_files.Push(GetAbsoluteFilePath(arg));
+        }
+    }
+
+    String GetAbsoluteFilePath(const String& file_path)
+    {
+        auto path = GetInternalPath(file_path);
+        if (IsAbsolutePath(path))
+            return path;
+        return context_->GetFileSystem()->GetCurrentDir() + path;
+    }
+
+    bool IsBatchMode() const { return !_batch_command.Empty() || _serve || !_replay_path.Empty(); }
+
+    /// Return value of `--name=value` command line option.
+    String GetOption(const String& name, const String& default_value = String::EMPTY) const
+    {
+        auto it = _options.Find(name);
+        return it == _options.End() ? default_value : it->second_;
+    }
+
+    /// Show error to the user. Batch mode prints it to stderr instead of opening a message box.
+    void ShowError(const String& message)
+    {
+        if (IsBatchMode())
+            PrintLine(message, true);
+        else
+            tinyfd_messageBox("Error", message.CString(), "ok", "error", 1);
     }
 
     void Start() override
     {
+        context_->RegisterFactory<UrhoUI::UI>();
+        context_->RegisterSubsystem(context_->CreateObject<UrhoUI::UI>());
+        _ui = GetSubsystem<UrhoUI::UI>();
+        context_->RegisterSubsystem(new TraceRecorder(context_));
+        _trace = GetSubsystem<TraceRecorder>();
+        context_->RegisterSubsystem(new FrameProfiler(context_));
+        _profiler = GetSubsystem<FrameProfiler>();
+        _profiler->SetTraceRecorder(_trace);
+
+        if (!_trace_file_path.Empty())
+            _trace->Start(_trace_file_path);
+
+        if (!_replay_path.Empty())
+        {
+            if (!StartReplay())
+            {
+                exitCode_ = EXIT_FAILURE;
+                _trace->Stop();
+                engine_->Exit();
+            }
+            return;
+        }
+
+        if (IsBatchMode())
+        {
+            exitCode_ = _serve ? RunServer() : RunBatch();
+            // Application does not call Stop() when exit code is non-zero.
+            _trace->Stop();
+            engine_->Exit();
+            return;
+        }
+
         cursors[RESIZE_MOVE] = SDL_CreateSystemCursor(SDL_SYSTEM_CURSOR_SIZEALL);
         cursors[RESIZE_LEFT] = cursors[RESIZE_RIGHT] = SDL_CreateSystemCursor(SDL_SYSTEM_CURSOR_SIZEWE);
         cursors[RESIZE_BOTTOM] = cursors[RESIZE_TOP] = SDL_CreateSystemCursor(SDL_SYSTEM_CURSOR_SIZENS);
@@ -107,9 +310,6 @@ public:
         cursors[RESIZE_TOP | RESIZE_RIGHT] = cursors[RESIZE_BOTTOM | RESIZE_LEFT] = SDL_CreateSystemCursor(SDL_SYSTEM_CURSOR_SIZENESW);
         cursor_arrow = SDL_CreateSystemCursor(SDL_SYSTEM_CURSOR_ARROW);
 
-        context_->RegisterFactory<UrhoUI::UI>();
-        context_->RegisterSubsystem(context_->CreateObject<UrhoUI::UI>());
-        _ui = GetSubsystem<UrhoUI::UI>();
         GetSubsystem<SystemUI>()->AddFont("Fonts/fontawesome-webfont.ttf", 0, {ICON_MIN_FA, ICON_MAX_FA, 0}, true);
 
         // UI style
@@ -132,17 +332,26 @@ public:
         GetSubsystem<Renderer>()->SetViewport(0, new Viewport(context_, _scene, _camera));
 
         // Events
+        _style_index.SetRoot(_ui->GetRoot());
+        SubscribeToEvent(E_BEGINFRAME, std::bind(&InputRecorder::BeginFrame, &_recorder));
         SubscribeToEvent(E_UPDATE, std::bind(&UIEditorApplication::OnUpdate, this, _2));
         SubscribeToEvent(E_SYSTEMUIFRAME, std::bind(&UIEditorApplication::RenderSystemUI, this));
         SubscribeToEvent(E_DROPFILE, std::bind(&UIEditorApplication::OnFileDrop, this, _2));
 
         // Arguments
-        for (auto arg: GetArguments())
-            LoadFile(arg);
+        for (const auto& file_path: _input_files)
+            LoadFile(file_path);
+
+        auto record_path = GetOption("record");
+        if (!record_path.Empty())
+            StartRecording(GetAbsoluteFilePath(record_path));
     }
 
     void Stop() override
     {
+        StopRecording();
+        _undo.CloseSession();
+        _trace->Stop();
     }
 
     Vector3 ScreenToWorld(IntVector2 screen_pos)
@@ -161,29 +370,30 @@ public:
             pos.y_ + wh / 2
         );
 
-        auto a = ScreenToWorld({rect.left_, rect.top_});
-        auto b = ScreenToWorld({rect.right_, rect.top_});
-        auto c = ScreenToWorld({rect.right_, rect.bottom_});
-        auto d = ScreenToWorld({rect.left_, rect.bottom_});
-
-        if (!_hide_resize_handles)
+        // Replay has no viewport to draw into.
+        if (!_hide_resize_handles && _debug.NotNull())
         {
+            auto a = ScreenToWorld({rect.left_, rect.top_});
+            auto b = ScreenToWorld({rect.right_, rect.top_});
+            auto c = ScreenToWorld({rect.right_, rect.bottom_});
+            auto d = ScreenToWorld({rect.left_, rect.bottom_});
             _debug->AddTriangle(a, b, c, Color::RED, false);
             _debug->AddTriangle(a, c, d, Color::RED, false);
         }
 
-        auto input = context_->GetInput();
-        return rect.IsInside(input->GetMousePosition()) == INSIDE;
+        return rect.IsInside(_recorder.GetMousePosition()) == INSIDE;
     }
 
     void OnUpdate(VariantMap& args)
     {
+        FrameProfileScope profile_scope(_profiler, FrameProfiler::PHASE_UPDATE);
+
         if (_selected.Null() || _selected == _ui->GetRoot())
             return;
 
         auto pos = _selected->GetScreenPosition();
         auto size = _selected->GetSize();
-        auto input = context_->GetInput();
+        auto input = &_recorder;
 
         bool was_not_moving = _resizing == RESIZE_NONE;
 
@@ -210,10 +420,9 @@ public:
         if (can_resize_vertical && RenderHandle(pos + IntVector2(size.x_ / 2, size.y_)))
             resizing = RESIZE_BOTTOM;
 
-        if (resizing == RESIZE_NONE)
-            SDL_SetCursor(cursor_arrow);
-        else
-            SDL_SetCursor(cursors[resizing]);
+        // Replay has no window.
+        if (!IsBatchMode())
+            SDL_SetCursor(resizing == RESIZE_NONE ? cursor_arrow : cursors[resizing]);
 
         if (input->GetMouseButtonDown(MOUSEB_LEFT))
         {
@@ -228,11 +437,11 @@ public:
         if (_resizing != RESIZE_NONE)
         {
             if (was_not_moving)
-                _undo.TrackValue(_selected, {{"Position", _selected->GetPosition()}, {"Size", _selected->GetSize()}});
+                TrackGeometry();
 
             if (!input->GetMouseButtonDown(MOUSEB_LEFT))
             {
-                _undo.TrackValue(_selected, {{"Position", _selected->GetPosition()}, {"Size", _selected->GetSize()}});
+                TrackGeometry();
                 _resizing = RESIZE_NONE;
             }
 
@@ -263,10 +472,29 @@ public:
         }
     }
 
+    /// Save position and size of selected element to undo stack.
+    void TrackGeometry()
+    {
+        static const String position("Position");
+        static const String size("Size");
+        _tracked_geometry[position] = _selected->GetPosition();
+        _tracked_geometry[size] = _selected->GetSize();
+        _undo.TrackValue(_selected, _tracked_geometry);
+    }
+
     void RenderSystemUI()
     {
-        _ui->Render(true);
-        _debug->Render();
+        AllocationScope allocation_scope("RenderSystemUI");
+        _frame_arena.Reset();
+        _profiler->SetEnabled(_show_profiler);
+        {
+            FrameProfileScope profile_scope(_profiler, FrameProfiler::PHASE_UI_RENDER);
+            _ui->Render(true);
+        }
+        {
+            FrameProfileScope profile_scope(_profiler, FrameProfiler::PHASE_DEBUG_RENDER);
+            _debug->Render();
+        }
 
         if (_selected.NotNull())
             _ui->DebugDraw(_selected);
@@ -276,20 +504,30 @@ public:
             if (ui::BeginMenu("File"))
             {
                 if (ui::MenuItem(ICON_FA_FILE_TEXT " New"))
+                {
+                    _recorder.RecordAction("new");
+                    _undo.CloseSession();
                     _ui->GetRoot()->RemoveAllChildren();
+                }
 
                 const char* filters[] = {"*.xml"};
                 if (ui::MenuItem(ICON_FA_FOLDER_OPEN " Open"))
                 {
                     auto filename = tinyfd_openFileDialog("Open file", ".", 2, filters, "XML files", 0);
                     if (filename)
+                    {
+                        _recorder.RecordAction("load", filename);
                         LoadFile(filename);
+                    }
                 }
 
                 if (ui::MenuItem(ICON_FA_FLOPPY_O " Save UI As") && _ui->GetRoot()->GetNumChildren() > 0)
                 {
                     if (auto path = tinyfd_saveFileDialog("Save UI file", ".", 1, filters, "XML files"))
+                    {
+                        _recorder.RecordAction("save_ui", path);
                         SaveFileUI(path);
+                    }
                 }
 
                 if (ui::MenuItem(ICON_FA_FLOPPY_O " Save Style As") && _style_file.NotNull())
@@ -298,13 +536,94 @@ public:
                         SaveFileStyle(path);
                 }
 
+                if (ui::MenuItem(ICON_FA_CODE " Export C++") && _ui->GetRoot()->GetNumChildren() > 0)
+                {
+                    const char* code_filters[] = {"*.h", "*.hpp"};
+                    if (auto path = tinyfd_saveFileDialog("Export C++ code", ".", 2, code_filters, "C++ headers"))
+                        ExportCode(path);
+                }
+
+                if (ui::MenuItem(ICON_FA_COMPRESS " Minify On Save", nullptr, &_minify_on_save))
+                    _recorder.RecordAction("minify_on_save", String::EMPTY, _minify_on_save);
+                if (ui::IsItemHovered())
+                    ui::SetTooltip("Do not save attributes that are equal to style or default values.");
+
+                ui::EndMenu();
+            }
+
+            if (ui::BeginMenu("Tools"))
+            {
+                ui::MenuItem(ICON_FA_TACHOMETER " Frame Profiler", nullptr, &_show_profiler);
+                if (ui::MenuItem(ICON_FA_BAR_CHART " Render Cost", nullptr, &_show_render_cost) && _show_render_cost)
+                    _render_cost.Analyze(_ui->GetRoot(), _ui->GetCursor());
+                ui::MenuItem(ICON_FA_TH " Overdraw Heatmap", nullptr, &_show_overdraw);
+                if (ui::MenuItem(ICON_FA_OBJECT_GROUP " Pack Texture Atlas") && _ui->GetRoot()->GetNumChildren() > 0)
+                {
+                    const char* atlas_filters[] = {"*.png"};
+                    if (auto path = tinyfd_saveFileDialog("Save texture atlas", "Atlas.png", 1, atlas_filters,
+                                                          "PNG images"))
+                        PackTextureAtlas(path);
+                }
+                if (ui::MenuItem(ICON_FA_SCISSORS " Unused Styles") && _style_file.NotNull())
+                {
+                    if (auto path = tinyfd_selectFolderDialog("Select layout directory", "."))
+                    {
+                        AnalyzeStyleUsage(Vector<String>(1, GetAbsoluteFilePath(path)));
+                        _show_style_usage = true;
+                    }
+                }
+                if (ui::MenuItem(ICON_FA_DATABASE " Project Index", nullptr, &_show_project_index) &&
+                    _show_project_index && _project_index.GetRoot().Empty())
+                {
+                    if (auto path = tinyfd_selectFolderDialog("Select project directory", "."))
+                        UpdateProjectIndex(GetAbsoluteFilePath(path));
+                }
+                ui::MenuItem(ICON_FA_EXCHANGE " Find Usages / Rename", nullptr, &_show_rename);
+                ui::MenuItem(ICON_FA_RANDOM " Generate Layout", nullptr, &_show_generator);
+                ui::MenuItem(ICON_FA_HISTORY " Undo History", nullptr, &_show_undo_history);
+                if (ui::MenuItem(ICON_FA_SITEMAP " Collapse Redundant Wrappers") &&
+                    _ui->GetRoot()->GetNumChildren() > 0)
+                {
+                    _recorder.RecordAction("collapse_wrappers");
+                    CollapseWrappers();
+                    _show_optimizer_report = true;
+                }
+
+                if (!_trace->IsRecording())
+                {
+                    if (ui::MenuItem(ICON_FA_CIRCLE " Start Trace"))
+                    {
+                        const char* trace_filters[] = {"*.json"};
+                        if (auto path = tinyfd_saveFileDialog("Save trace file", "trace.json", 1, trace_filters,
+                                                              "Chrome trace files"))
+                            _trace->Start(path);
+                    }
+                }
+                else if (ui::MenuItem(ICON_FA_STOP " Stop Trace"))
+                    _trace->Stop();
+
+                if (!_recorder.IsRecording())
+                {
+                    if (ui::MenuItem(ICON_FA_VIDEO_CAMERA " Start Recording"))
+                    {
+                        const char* recording_filters[] = {"*.uirec"};
+                        if (auto path = tinyfd_saveFileDialog("Save input recording", "session.uirec", 1,
+                                                              recording_filters, "Input recordings"))
+                            StartRecording(path);
+                    }
+                }
+                else if (ui::MenuItem(ICON_FA_STOP " Stop Recording"))
+                    StopRecording();
                 ui::EndMenu();
             }
 
             if (ui::Button(ICON_FA_FLOPPY_O))
             {
                 if (!_current_file_path.Empty())
+                {
+                    _recorder.RecordAction("save_ui", _current_file_path);
                     SaveFileUI(_current_file_path);
+                }
                 if (!_style_file.Null())
                     SaveFileStyle(_current_style_file_path);
             }
@@ -315,8 +634,8 @@ public:
 
             if (ui::Button(ICON_FA_UNDO))
             {
-                _undo.Undo();
-                _clear_buffers = true;
+                _recorder.RecordAction("undo");
+                Undo();
             }
             if (ui::IsItemHovered())
                 ui::SetTooltip("Undo.");
@@ -324,8 +643,8 @@ public:
 
             if (ui::Button(ICON_FA_REPEAT))
             {
-                _undo.Redo();
-                _clear_buffers = true;
+                _recorder.RecordAction("redo");
+                Redo();
             }
             if (ui::IsItemHovered())
                 ui::SetTooltip("Redo.");
@@ -337,6 +656,14 @@ public:
             ui::Checkbox("Hide Resize Handles", &_hide_resize_handles);
             ui::SameLine();
 
+            if (!_status_message.Empty())
+                ui::TextDisabled("%s", _status_message.CString());
+            if (!_budget_warning.Empty())
+            {
+                ui::SameLine();
+                ui::TextColored(ToImGui(Color::RED), "%s", _budget_warning.CString());
+            }
+
             ui::EndMainMenuBar();
         }
 
@@ -351,6 +678,7 @@ public:
         if (ui::Begin("ElementTree", nullptr, panel_flags))
         {
             root_pos.x_ = static_cast<int>(ui::GetWindowWidth());
+            FrameProfileScope profile_scope(_profiler, FrameProfiler::PHASE_UI_TREE);
             RenderUITree(_ui->GetRoot());
         }
         ui::End();
@@ -362,46 +690,65 @@ public:
         {
             root_size.x_ = static_cast<int>(window_width - root_pos.x_ - ui::GetWindowWidth());
             if (_selected)
+            {
+                FrameProfileScope profile_scope(_profiler, FrameProfiler::PHASE_ATTRIBUTES);
                 RenderAttributes(_selected);
+            }
         }
         ui::End();
-        
-        _ui->GetRoot()->SetSize(root_size);
-        _ui->GetRoot()->SetPosition(root_pos);
 
-        auto input = context_->GetInput();
-        if (_resizing == RESIZE_NONE && input->GetMouseButtonPress(MOUSEB_LEFT) || input->GetMouseButtonPress(MOUSEB_RIGHT))
+        if (_show_profiler)
         {
-            auto pos = input->GetMousePosition();
-            auto clicked = _ui->GetElementAt(pos, false);
-            if (!clicked && _ui->GetRoot()->GetCombinedScreenRect().IsInside(pos) == INSIDE)
-                clicked = _ui->GetRoot();
-
-            if (clicked)
-                SelectItem(clicked);
+            _profiler->SetGauge(FrameProfiler::GAUGE_EDIT_BUFFER_BYTES, _edit_buffers.GetMemoryUse());
+            _profiler->SetGauge(FrameProfiler::GAUGE_STYLE_INDEXED_ELEMENTS, _style_index.GetNumIndexed());
+            _profiler->RenderOverlay(&_show_profiler);
         }
 
+        if (_show_render_cost)
+            RenderRenderCost();
+
+        if (_show_overdraw)
+            RenderOverdraw();
+
+        if (_show_optimizer_report)
+            RenderOptimizerReport();
+
+        if (_show_style_usage)
+            RenderStyleUsage();
+
+        if (_show_project_index)
+            RenderProjectIndex();
+
+        if (_show_rename)
+            RenderRename();
+
+        if (_show_generator)
+            RenderGenerator();
+
+        if (_show_undo_history)
+            RenderUndoHistory();
+
+        if (_rename_pending && _rename.IsFinished())
+            FinishRename();
+
+        _ui->GetRoot()->SetSize(root_size);
+        _ui->GetRoot()->SetPosition(root_pos);
+        _recorder.SetRootRect(root_pos, root_size);
+        _recorder.SetItemActive(ui::IsAnyItemActive());
+        HandleViewportInput();
+        _style_index.ApplyPendingRestyle();
+
         if (_selected)
         {
-            if (input->GetKeyPress(KEY_DELETE) && _selected != _ui->GetRoot())
-            {
-                _undo.TrackRemoval(_selected);
-                _selected->Remove();
-                SelectItem(nullptr);
-            }
-
             if (ui::BeginPopupContextVoid("Element Context Menu", 2))
             {
                 if (ui::BeginMenu("Add Child"))
                 {
-                    const char* ui_types[] = {"BorderImage", "Button", "CheckBox", "Cursor", "DropDownList", "LineEdit",
-                        "ListView", "Menu", "ProgressBar", "ScrollBar", "ScrollView", "Slider", "Sprite", "Text",
-                        "ToolTip", "UIElement", "View3D", "Window", 0
-                    };
+                    const auto& ui_types = UI_ELEMENT_TYPES;
                     for (auto i = 0; ui_types[i] != 0; i++)
                     {
                         // TODO: element creation with custom styles more usable.
-                        if (input->GetKeyDown(KEY_SHIFT))
+                        if (_recorder.GetKeyDown(KEY_SHIFT))
                         {
                             if (ui::BeginMenu(ui_types[i]))
                             {
@@ -409,9 +756,8 @@ public:
                                 {
                                     if (ui::MenuItem(_style_names[j].CString()))
                                     {
-                                        SelectItem(_selected->CreateChild(ui_types[i]));
-                                        _selected->SetStyle(_style_names[j]);
-                                        _undo.TrackAddition(_selected);
+                                        _recorder.RecordAction("add_child", ui_types[i], _style_names[j]);
+                                        AddChildElement(ui_types[i], _style_names[j]);
                                     }
                                 }
                                 ui::EndMenu();
@@ -421,9 +767,8 @@ public:
                         {
                             if (ui::MenuItem(ui_types[i]))
                             {
-                                SelectItem(_selected->CreateChild(ui_types[i]));
-                                _selected->SetStyleAuto();
-                                _undo.TrackAddition(_selected);
+                                _recorder.RecordAction("add_child", ui_types[i]);
+                                AddChildElement(ui_types[i]);
                             }
                         }
                     }
@@ -434,40 +779,101 @@ public:
                 {
                     if (ui::MenuItem("Delete Element"))
                     {
-                        _undo.TrackRemoval(_selected);
-                        _selected->Remove();
-                        SelectItem(nullptr);
+                        _recorder.RecordAction("delete");
+                        DeleteSelected();
                     }
 
                     if (ui::MenuItem("Bring To Front"))
+                    {
+                        _recorder.RecordAction("bring_to_front");
                         _selected->BringToFront();
+                    }
                 }
                 ui::EndPopup();
             }
         }
+    }
+
+    /// Select clicked element, delete selection and undo or redo by keyboard. Input comes from recorder, so this also
+    /// runs during replay.
+    void HandleViewportInput()
+    {
+        const auto& input = _recorder;
+        if (_resizing == RESIZE_NONE && input.GetMouseButtonPress(MOUSEB_LEFT) ||
+            input.GetMouseButtonPress(MOUSEB_RIGHT))
+        {
+            auto pos = input.GetMousePosition();
+            auto clicked = _ui->GetElementAt(pos, false);
+            if (!clicked && _ui->GetRoot()->GetCombinedScreenRect().IsInside(pos) == INSIDE)
+                clicked = _ui->GetRoot();
+
+            if (clicked)
+                SelectItem(clicked);
+        }
 
-        _clear_buffers = false;
-        if (!ui::IsAnyItemActive())
+        if (_selected && input.GetKeyPress(KEY_DELETE) && _selected != _ui->GetRoot())
+            DeleteSelected();
+
+        if (!input.IsItemActive())
         {
-            if (input->GetKeyDown(KEY_CTRL))
+            if (input.GetKeyDown(KEY_CTRL))
             {
-                if (input->GetKeyPress(KEY_Y) || (input->GetKeyDown(KEY_SHIFT) && input->GetKeyPress(KEY_Z)))
-                {
-                    _undo.Redo();
-                    _clear_buffers = true;
-                }
-                else if (input->GetKeyPress(KEY_Z))
-                {
-                    _undo.Undo();
-                    _clear_buffers = true;
-                }
+                if (input.GetKeyPress(KEY_Y) || (input.GetKeyDown(KEY_SHIFT) && input.GetKeyPress(KEY_Z)))
+                    Redo();
+                else if (input.GetKeyPress(KEY_Z))
+                    Undo();
             }
         }
     }
 
+    void Undo()
+    {
+        _undo.Undo();
+        _edit_buffers.ReleaseAll();
+        for (const auto& change: _undo.GetModifiedStyles())
+            _style_index.InvalidateStyle(change);
+    }
+
+    void Redo()
+    {
+        _undo.Redo();
+        _edit_buffers.ReleaseAll();
+        for (const auto& change: _undo.GetModifiedStyles())
+            _style_index.InvalidateStyle(change);
+    }
+
+    /// Return to state of undo history, which may be on another branch.
+    void JumpToUndoState(int state)
+    {
+        _undo.JumpTo(state);
+        _edit_buffers.ReleaseAll();
+        for (const auto& change: _undo.GetModifiedStyles())
+            _style_index.InvalidateStyle(change);
+    }
+
+    /// Create child of selected element and select it. Empty `style` picks style automatically.
+    void AddChildElement(const String& type, const String& style = String::EMPTY)
+    {
+        SelectItem(_selected->CreateChild(StringHash(type)));
+        if (style.Empty())
+            _selected->SetStyleAuto();
+        else
+            _selected->SetStyle(style);
+        _undo.TrackAddition(_selected);
+    }
+
+    void DeleteSelected()
+    {
+        _undo.TrackRemoval(_selected);
+        _selected->Remove();
+        SelectItem(nullptr);
+    }
+
     void OnFileDrop(VariantMap& args)
     {
-        LoadFile(args[DropFile::P_FILENAME].GetString());
+        const auto& file_path = args[DropFile::P_FILENAME].GetString();
+        _recorder.RecordAction("load", file_path);
+        LoadFile(file_path);
     }
 
     String GetResourcePath(String file_path)
@@ -481,6 +887,7 @@ public:
 
     bool LoadFile(const String& file_path)
     {
+        TraceZone trace_zone(_trace, "LoadFile", "io");
         auto cache = GetSubsystem<ResourceCache>();
         if (!_current_file_path.Empty())
             cache->RemoveResourceDir(GetResourcePath(_current_file_path));
@@ -499,14 +906,23 @@ public:
                     // This is a style.
                     _ui->GetRoot()->SetDefaultStyle(xml);
                     _style_file = xml;
+                    _style_index.SetStyleFile(xml);
                     _current_style_file_path = file_path;
+                    _undo.SetSessionStyle(xml, file_path);
 
                     auto styles = _style_file->GetRoot().SelectPrepared(XPathQuery("/elements/element"));
+                    _profiler->Count(FrameProfiler::COUNTER_XPATH_QUERIES);
+                    HashSet<String> known_names;
+                    for (const auto& name: _style_names)
+                        known_names.Insert(name);
                     for (auto i = 0; i < styles.Size(); i++)
                     {
                         auto type = styles[i].GetAttribute("type");
-                        if (type.Length() && !_style_names.Contains(type))
+                        if (type.Length() && !known_names.Contains(type))
+                        {
+                            known_names.Insert(type);
                             _style_names.Push(type);
+                        }
                     }
                     Sort(_style_names.Begin(), _style_names.End());
                     UpdateWindowTitle();
@@ -520,11 +936,19 @@ public:
                     {
                         child->SetStyleAuto();
                         _current_file_path = file_path;
+                        _budget_warning.Clear();
                         UpdateWindowTitle();
 
                         for (auto old_child : children)
                             old_child->Remove();
 
+                        if (UsesUndoSessions())
+                            OpenUndoSession(file_path, *xml);
+                        else
+                        {
+                            _undo.CloseSession();
+                            _undo.Clear();
+                        }
                         return true;
                     }
                     else
@@ -534,139 +958,783 @@ public:
         }
 
         cache->RemoveResourceDir(resource_dir);
-        tinyfd_messageBox("Error", "Opening XML file failed", "ok", "error", 1);
+        ShowError("Opening XML file failed: " + file_path);
         return false;
     }
 
-    bool SaveFileUI(const String& file_path)
+    /// Serialize current layout without internal elements.
+    bool SerializeLayout(XMLFile& xml)
+    {
+        XMLElement root = xml.CreateRoot("element");
+        if (!_ui->GetRoot()->GetChild(0)->SaveXML(root))
+            return false;
+
+        // Remove internal UI elements
+        auto result = root.SelectPrepared(XPathQuery("//element[@internal=\"true\"]"));
+        _profiler->Count(FrameProfiler::COUNTER_XPATH_QUERIES);
+        for (auto el = result.FirstResult(); el.NotNull(); el = el.NextResult())
+            el.GetParent().RemoveChild(el);
+
+        // Remove style="none"
+        root.SelectPrepared(XPathQuery("//element[@style=\"none\"]"));
+        _profiler->Count(FrameProfiler::COUNTER_XPATH_QUERIES);
+        for (auto el = result.FirstResult(); el.NotNull(); el = el.NextResult())
+            el.RemoveAttribute("style");
+        return true;
+    }
+
+    /// Remove attributes equal to style or default values from serialized layout.
+    void MinifyLayout(XMLFile& xml, const String& file_path)
+    {
+        TraceZone trace_zone(_trace, "MinifyLayout", "io");
+        _minifier.Minify(&xml, _style_file);
+        _status_message = ToString("%s: removed %u attributes, %u -> %u bytes", GetBaseName(file_path).CString(),
+                                   _minifier.GetRemovedAttributes(), _minifier.GetBytesBefore(),
+                                   _minifier.GetBytesAfter());
+    }
+
+    /// Return true if undo history is kept in session files. Recording and replay start every layout with empty
+    /// history instead, so recorded undo steps act on the same states.
+    bool UsesUndoSessions() const
+    {
+        return !IsBatchMode() && !_recorder.IsRecording();
+    }
+
+    /// Restore undo history of layout loaded from `file_path` from its session file, or start a new session file.
+    /// History of previous document is dropped, its elements are gone.
+    void OpenUndoSession(const String& file_path, XMLFile& xml)
+    {
+        auto restored = _undo.OpenSession(UndoManager::GetSessionPath(file_path), _ui->GetRoot(),
+                                          StringHash(xml.ToString()).Value());
+        if (restored)
+            _status_message = ToString("Restored %u undo states", _undo.GetNumStates());
+    }
+
+    /// Save layout to `file_path` and check its budget. Exceeded limits are stored to `violations` when given.
+    bool SaveFileUI(const String& file_path, Vector<BudgetViolation>* violations = nullptr)
     {
+        TraceZone trace_zone(_trace, "SaveFileUI", "io");
         if (file_path.EndsWith(".xml", false))
         {
             XMLFile xml(context_);
-            XMLElement root = xml.CreateRoot("element");
-            if (_ui->GetRoot()->GetChild(0)->SaveXML(root))
+            if (SerializeLayout(xml))
             {
-                // Remove internal UI elements
-                auto result = root.SelectPrepared(XPathQuery("//element[@internal=\"true\"]"));
-                for (auto el = result.FirstResult(); el.NotNull(); el = el.NextResult())
-                    el.GetParent().RemoveChild(el);
-
-                // Remove style="none"
-                root.SelectPrepared(XPathQuery("//element[@style=\"none\"]"));
-                for (auto el = result.FirstResult(); el.NotNull(); el = el.NextResult())
-                    el.RemoveAttribute("style");
+                if (_minify_on_save)
+                    MinifyLayout(xml, file_path);
 
                 File saveFile(context_, file_path, FILE_WRITE);
                 xml.Save(saveFile);
 
                 _current_file_path = file_path;
                 UpdateWindowTitle();
+                Vector<BudgetViolation> exceeded;
+                CheckBudget(file_path, saveFile.GetSize(), exceeded);
+                if (violations != nullptr)
+                    *violations = exceeded;
+                _undo.MarkSaved();
+                if (UsesUndoSessions())
+                    _undo.SaveSession(UndoManager::GetSessionPath(file_path), _ui->GetRoot(),
+                                      StringHash(xml.ToString()).Value());
                 return true;
             }
         }
 
-        tinyfd_messageBox("Error", "Saving UI file failed", "ok", "error", 1);
+        ShowError("Saving UI file failed: " + file_path);
+        return false;
+    }
+
+    /// Measure current layout for budget checks. `file_size` is size of its saved file.
+    LayoutMetrics MeasureLayout(unsigned file_size)
+    {
+        LayoutMetrics metrics;
+        LayoutBudget::MeasureTree(_ui->GetRoot()->GetChild(0u), metrics);
+        _render_cost.Analyze(_ui->GetRoot(), _ui->GetCursor());
+        metrics.draw_calls = _render_cost.GetTotal().draw_calls;
+        metrics.textures = _render_cost.GetNumTextures();
+        _overdraw.Analyze(_ui->GetRoot());
+        metrics.overdraw = _overdraw.GetOverdrawFactor();
+        metrics.file_size = file_size;
+        return metrics;
+    }
+
+    /// Load budget given by `--budget` option or budget file next to layout. Return false when layout has no budget
+    /// or budget file is invalid, then budget holds the error.
+    bool LoadBudget(const String& layout_path, LayoutBudget& budget)
+    {
+        auto budget_path = GetOption("budget");
+        if (budget_path.Empty())
+            budget_path = LayoutBudget::GetBudgetPath(layout_path);
+        else
+            budget_path = GetAbsoluteFilePath(budget_path);
+        return budget.Load(context_, budget_path);
+    }
+
+    /// Compare layout saved to `file_path` against its budget and show exceeded limits in main menu bar. Return false
+    /// when layout exceeds its budget or budget file is invalid, `violations` receives exceeded limits.
+    bool CheckBudget(const String& file_path, unsigned file_size, Vector<BudgetViolation>& violations)
+    {
+        TraceZone trace_zone(_trace, "CheckBudget", "io");
+        violations.Clear();
+        LayoutBudget budget;
+        if (!LoadBudget(file_path, budget))
+        {
+            _budget_warning = budget.GetError();
+            return _budget_warning.Empty();
+        }
+
+        violations = budget.Check(MeasureLayout(file_size));
+        if (violations.Empty())
+            _budget_warning.Clear();
+        else
+            _budget_warning = "Over budget: " + LayoutBudget::ToString(violations);
+        return violations.Empty();
+    }
+
+    /// Save layout from batch command. Layout that exceeds its budget is saved, but fails `result`.
+    bool BatchSaveLayout(const String& file_path, JSONValue& result)
+    {
+        Vector<BudgetViolation> violations;
+        if (!SaveFileUI(file_path, &violations))
+            return false;
+        if (_budget_warning.Empty())
+            return true;
+
+        result["violations"] = LayoutBudget::ToJSON(violations);
+        result["error"] = _budget_warning;
         return false;
     }
 
     bool SaveFileStyle(const String& file_path)
     {
+        TraceZone trace_zone(_trace, "SaveFileStyle", "io");
         if (file_path.EndsWith(".xml", false) && _style_file.NotNull())
         {
             File saveFile(context_, file_path, FILE_WRITE);
             _style_file->Save(saveFile);
 
             _current_style_file_path = file_path;
+            _undo.SetSessionStyle(_style_file, file_path);
             UpdateWindowTitle();
             return true;
         }
 
-        tinyfd_messageBox("Error", "Saving UI file failed", "ok", "error", 1);
+        ShowError("Saving style file failed: " + file_path);
         return false;
     }
 
-    void RenderUITree(UIElement* element)
+    /// Write header with function that constructs current layout to `file_path`. Function is named after the file.
+    bool ExportCode(const String& file_path)
     {
-        auto& name = element->GetName();
-        auto& type = element->GetTypeName();
-        auto tooltip = "Type: " + type;
-        ImGuiTreeNodeFlags flags = ImGuiTreeNodeFlags_OpenOnArrow | ImGuiTreeNodeFlags_OpenOnDoubleClick;
-        bool is_internal = element->IsInternal();
-        if (is_internal && !_show_internal)
-            return;
-        else
-            flags |= ImGuiTreeNodeFlags_DefaultOpen;
-
-        if (_show_internal)
-            tooltip += String("\nInternal: ") + (is_internal ? "true" : "false");
-
-        if (element == _selected)
-            flags |= ImGuiTreeNodeFlags_Selected;
+        TraceZone trace_zone(_trace, "ExportCode", "io");
+        String source_name = "unsaved layout";
+        if (!_current_file_path.Empty())
+            source_name = GetFileNameAndExtension(_current_file_path);
+        auto code = _code_generator.Generate(_ui->GetRoot()->GetChild(0u),
+                                             LayoutCodeGenerator::MakeFunctionName(file_path), source_name);
 
-        if (ui::TreeNodeEx(element, flags, "%s", name.Length() ? name.CString() : type.CString()))
+        File file(context_, file_path, FILE_WRITE);
+        if (!file.IsOpen() || file.Write(code.CString(), code.Length()) != code.Length())
         {
-            if (ui::IsItemHovered())
-                ui::SetTooltip(tooltip.CString());
+            ShowError("Exporting C++ code failed: " + file_path);
+            return false;
+        }
 
-            if (ui::IsItemHovered() && ui::IsMouseClicked(0))
-                SelectItem(element);
+        _status_message = ToString("%s: %u elements, %u attributes", GetFileNameAndExtension(file_path).CString(),
+                                   _code_generator.GetNumElements(), _code_generator.GetNumAttributes());
+        if (!_code_generator.GetSkippedAttributes().Empty())
+            _status_message += ToString(", %u skipped", _code_generator.GetSkippedAttributes().Size());
+        return true;
+    }
 
-            for (auto child: element->GetChildren())
-                RenderUITree(child);
-            ui::TreePop();
+    /// Return name of file in resource cache or empty string when file is not in any resource directory.
+    String GetResourceName(const String& file_path)
+    {
+        auto path = GetInternalPath(file_path);
+        for (const auto& resource_dir: GetSubsystem<ResourceCache>()->GetResourceDirs())
+        {
+            if (path.StartsWith(resource_dir, false))
+                return path.Substring(resource_dir.Length());
         }
+        return String::EMPTY;
     }
 
-    String GetAppliedStyle(UIElement* element = nullptr)
+    /// Pack images referenced by current layout and style into atlas saved to `file_path` and use it in layout and
+    /// style.
+    bool PackTextureAtlas(const String& file_path)
     {
-        if (element == nullptr)
-            element = _selected;
+        _atlas_packer.Clear();
+        _atlas_packer.CollectElements(_ui->GetRoot());
+        _atlas_packer.CollectStyle(_style_file);
+        if (!SaveTextureAtlas(file_path))
+            return false;
+
+        _recorder.RecordAction("pack_atlas", GetResourceName(file_path), GetAtlasSettings());
+        ApplyTextureAtlas();
+        return true;
+    }
 
-        if (element == nullptr)
-            return "";
+    /// Pack atlas recorded by PackTextureAtlas() and use it like the recorded one. Atlas is not written, pages get
+    /// resource names of recorded atlas. `settings` are maximal page size and padding.
+    void ReplayTextureAtlas(const String& resource_name, const IntVector2& settings)
+    {
+        _atlas_packer.Clear();
+        _atlas_packer.CollectElements(_ui->GetRoot());
+        _atlas_packer.CollectStyle(_style_file);
+        if (!_atlas_packer.Pack(settings.x_, settings.y_))
+        {
+            PrintLine("Replay: " + _atlas_packer.GetError(), true);
+            return;
+        }
+        _atlas_packer.SetPageNames(resource_name);
+        ApplyTextureAtlas();
+    }
 
-        auto applied_style = _selected->GetAppliedStyle();
-        if (applied_style.Empty())
-            applied_style = _selected->GetTypeName();
-        return applied_style;
+    /// Return maximal atlas page size and padding given by `--atlas-size` and `--atlas-padding` options.
+    IntVector2 GetAtlasSettings() const
+    {
+        return IntVector2(ToInt(GetOption("atlas-size", String(TextureAtlasPacker::DEFAULT_MAX_SIZE))),
+                          ToInt(GetOption("atlas-padding", String(TextureAtlasPacker::DEFAULT_PADDING))));
     }
 
-    void RenderAttributes(Serializable* item)
+    /// Pack images collected by atlas packer and save atlas pages to `file_path`.
+    bool SaveTextureAtlas(const String& file_path)
     {
-        ui::Columns(2);
+        TraceZone trace_zone(_trace, "SaveTextureAtlas", "io");
+        auto resource_name = GetResourceName(file_path);
+        if (resource_name.Empty())
+        {
+            ShowError("Texture atlas must be saved into a resource directory: " + file_path);
+            return false;
+        }
 
-        ui::TextUnformatted("Filter");
-        ui::NextColumn();
-        if (ui::Button(ICON_FA_UNDO))
-            _filter.front() = 0;
-        if (ui::IsItemHovered())
-            ui::SetTooltip("Reset filter.");
-        ui::SameLine();
-        ui::PushID("FilterEdit");
-        ui::InputText("", &_filter.front(), _filter.size() - 1);
-        ui::PopID();
-        ui::NextColumn();
+        auto settings = GetAtlasSettings();
+        if (!_atlas_packer.Pack(settings.x_, settings.y_) || !_atlas_packer.Save(file_path, resource_name))
+        {
+            ShowError(_atlas_packer.GetError());
+            return false;
+        }
+        return true;
+    }
 
-        ui::TextUnformatted("Style");
-        ui::NextColumn();
+    /// Return true if `element` gets value of attribute `name` from its style. `value` receives value of the style
+    /// attribute from before it was pointed to texture atlas.
+    bool GetInheritedAtlasValue(UIElement* element, const String& name, Variant& value)
+    {
+        auto info = FindAttributeInfo(element, name);
+        if (info == nullptr || _style_file.Null())
+            return false;
+
+        auto style_root = _style_file->GetRoot();
+        const auto& applied_style = element->GetAppliedStyle();
+        auto attribute = FindStyleAttribute(style_root, FindStyle(style_root, applied_style.Empty() ?
+                                            element->GetTypeName() : applied_style), name);
+        if (attribute.IsNull() || GetAttributeValue(attribute, *info) != element->GetAttribute(name))
+            return false;
+
+        auto original = _atlas_style_values.Find(attribute.GetNode());
+        value = original != _atlas_style_values.End() ? GetAttributeValue(original->second_, *info) :
+                element->GetAttribute(name);
+        return true;
+    }
 
-        auto type_style = GetAppliedStyle();
-        ui::TextUnformatted(type_style.CString());
+    /// Point `Texture` and `Image Rect` attributes of layout elements and styles to packed atlas. Elements get only
+    /// attributes they set themselves, values they inherit follow their style. All changes are a single undo step.
+    void ApplyTextureAtlas(bool remap_elements = true, bool remap_styles = true)
+    {
+        static const String texture_name("Texture");
+        static const String image_rect_name("Image Rect");
 
-        ui::NextColumn();
+        struct ElementChange
+        {
+            WeakPtr<UIElement> element;
+            HashMap<String, Variant> old_values;
+            HashMap<String, Variant> new_values;
+        };
+        struct StyleChange
+        {
+            XMLElement style;
+            /// Texture and image rect style resolved before remapping.
+            String texture;
+            IntRect rect;
+            HashMap<String, Variant> old_values;
+            HashMap<String, Variant> new_values;
+        };
+        Vector<ElementChange> element_changes;
+        Vector<StyleChange> style_changes;
+
+        // Everything is remapped before anything changes, styles resolve values through their base styles.
+        if (remap_styles)
+            _atlas_style_values.Clear();
+        PODVector<UIElement*> elements;
+        if (remap_elements)
+            _ui->GetRoot()->GetChildren(elements, true);
+        for (auto element: elements)
+        {
+            String texture;
+            IntRect rect;
+            PODVector<IntVector2> offsets;
+            // Internal elements are not saved, nested styles remap them.
+            if (element->IsInternal() || !TextureAtlasPacker::GetElementImage(element, texture, rect, offsets))
+                continue;
+
+            Variant style_texture;
+            Variant style_rect;
+            auto own_texture = !GetInheritedAtlasValue(element, texture_name, style_texture);
+            auto own_rect = !GetInheritedAtlasValue(element, image_rect_name, style_rect);
+            if (!own_texture && !own_rect)
+                continue;
+            if (!own_texture)
+                texture = style_texture.GetResourceRef().name_;
+            if (!own_rect)
+                rect = style_rect.GetIntRect();
+
+            String atlas_texture;
+            IntRect atlas_rect;
+            if (!_atlas_packer.Remap(texture, rect, atlas_texture, atlas_rect))
+                continue;
+
+            ElementChange change;
+            change.element = element;
+            if (own_texture)
+            {
+                change.old_values[texture_name] = element->GetAttribute(texture_name);
+                change.new_values[texture_name] = ResourceRef(Texture2D::GetTypeStatic(), atlas_texture);
+            }
+            // Inherited image rect belongs to texture of style, element with own texture needs its own rect.
+            change.old_values[image_rect_name] = element->GetAttribute(image_rect_name);
+            change.new_values[image_rect_name] = atlas_rect;
+            element_changes.Push(change);
+        }
+
+        for (const auto& reference: TextureAtlasPacker::GetStyleReferences(remap_styles ? _style_file.Get() : nullptr))
+        {
+            StyleChange change;
+            change.style = reference.style;
+            change.texture = reference.texture;
+            change.rect = reference.rect;
+            for (const auto& name: {texture_name, image_rect_name})
+            {
+                auto attribute = GetStyleAttribute(reference.style, name);
+                change.old_values[name] = attribute.IsNull() ? Variant() : Variant(attribute.GetAttribute("value"));
+            }
+
+            String atlas_texture;
+            IntRect atlas_rect;
+            if (_atlas_packer.Remap(reference.texture, reference.rect, atlas_texture, atlas_rect))
+            {
+                if (reference.own_texture)
+                    change.new_values[texture_name] = "Texture2D;" + atlas_texture;
+                change.new_values[image_rect_name] = atlas_rect.ToString();
+            }
+            else if (reference.own_texture && !reference.own_rect)
+            {
+                // Inherited rect may be remapped to atlas while this texture stays, keep the rect it used so far.
+                change.new_values[image_rect_name] = reference.rect.ToString();
+            }
+            else
+                continue;
+            style_changes.Push(change);
+        }
+
+        _undo.BeginGroup();
+        for (const auto& change: element_changes)
+            _undo.TrackValue(change.element, change.old_values);
+        for (const auto& change: style_changes)
+            _undo.TrackStyleValue(change.style, change.old_values);
+        _undo.EndGroup();
+
+        for (const auto& change: element_changes)
+        {
+            for (const auto& it: change.new_values)
+                change.element->SetAttribute(it.first_, it.second_);
+            change.element->ApplyAttributes();
+            _profiler->Count(FrameProfiler::COUNTER_APPLY_ATTRIBUTES);
+        }
+        for (const auto& change: style_changes)
+        {
+            for (const auto& it: change.new_values)
+            {
+                SetStyleAttribute(change.style, it.first_, it.second_.GetString());
+                _atlas_style_values[GetStyleAttribute(change.style, it.first_).GetNode()] = it.first_ == texture_name ?
+                    "Texture2D;" + change.texture : change.rect.ToString();
+                auto old_value = change.old_values.Find(it.first_);
+                _style_index.InvalidateStyle(change.style, it.first_, old_value != change.old_values.End() ?
+                                             old_value->second_ : Variant());
+            }
+        }
+
+        _undo.BeginGroup();
+        for (const auto& change: element_changes)
+            _undo.TrackValue(change.element, change.new_values);
+        for (const auto& change: style_changes)
+        {
+            // Attributes that were not changed keep their old state.
+            auto values = change.old_values;
+            for (const auto& it: change.new_values)
+                values[it.first_] = it.second_;
+            _undo.TrackStyleValue(change.style, values);
+        }
+        _undo.EndGroup();
+        _edit_buffers.ReleaseAll();
+    }
+
+    /// Find styles of current style file that are not used by layouts in `paths` (files or directories).
+    void AnalyzeStyleUsage(const Vector<String>& paths)
+    {
+        TraceZone trace_zone(_trace, "AnalyzeStyleUsage", "io");
+        Vector<String> keep;
+        auto keep_option = GetOption("keep-styles");
+        if (!keep_option.Empty())
+            keep = keep_option.Split(',');
+
+        _style_usage.Analyze(_style_usage.FindLayoutFiles(paths), _style_file, keep);
+        _status_message = ToString("%u of %u styles unused", _style_usage.GetUnused().Size(),
+                                   _style_usage.GetStyles().Size());
+    }
+
+    /// Return path of index file of project in `root`, `--index` option overrides it.
+    String GetProjectIndexPath(const String& root)
+    {
+        auto index_path = GetOption("index");
+        if (!index_path.Empty())
+            return GetAbsoluteFilePath(index_path);
+        return AddTrailingSlash(root) + ".uiindex";
+    }
+
+    /// Load index of project in `root`, bring it up to date and save it if anything changed.
+    bool UpdateProjectIndex(const String& root)
+    {
+        TraceZone trace_zone(_trace, "UpdateProjectIndex", "io");
+        auto index_path = GetProjectIndexPath(root);
+        if (_project_index.GetRoot() != AddTrailingSlash(root))
+            _project_index.Load(index_path);
+
+        if (_project_index.Update(root) && !_project_index.Save(index_path))
+        {
+            ShowError("Saving project index failed: " + index_path);
+            return false;
+        }
+
+        _index_results.Clear();
+        _status_message = ToString("Indexed %u files, %u parsed, %u removed", _project_index.GetEntries().Size(),
+                                   _project_index.GetNumParsed(), _project_index.GetNumRemoved());
+        return true;
+    }
+
+    /// Return absolute paths of indexed files that may use style or resource `name`.
+    Vector<String> FindUsageCandidates(RenameKind kind, const String& name)
+    {
+        Vector<String> paths;
+        if (kind == RENAME_STYLE)
+        {
+            // Style sheets defining the style list it as a type.
+            paths = _project_index.Query(QUERY_STYLE, name);
+            for (const auto& path: _project_index.Query(QUERY_TYPE, name))
+            {
+                if (!paths.Contains(path))
+                    paths.Push(path);
+            }
+        }
+        else
+            paths = _project_index.Query(QUERY_RESOURCE, name);
+
+        for (auto& path: paths)
+            path = _project_index.GetRoot() + path;
+        return paths;
+    }
+
+    /// Find usages of `from` in indexed project and rename them to `to`, unless `to` is empty or `dry_run` is set.
+    /// Open layout and style are not rewritten, reloading them would discard edits that were not saved.
+    bool StartRename(RenameKind kind, const String& from, const String& to, bool dry_run)
+    {
+        if (from.Empty() || !UpdateProjectIndex(_project_index.GetRoot()))
+            return false;
+
+        auto files = FindUsageCandidates(kind, from);
+        _rename_skipped.Clear();
+        if (!dry_run && !to.Empty())
+        {
+            for (const auto& path: {_current_file_path, _current_style_file_path})
+            {
+                if (!path.Empty() && files.Remove(path))
+                    _rename_skipped.Push(path);
+            }
+        }
+        _rename_pending = _rename.Start(kind, from, to, files, dry_run);
+        return _rename_pending;
+    }
+
+    /// Handle results of rename started by StartRename().
+    void FinishRename()
+    {
+        _rename_pending = false;
+        if (!_rename.IsDryRun())
+            UpdateProjectIndex(_project_index.GetRoot());
+
+        _status_message = ToString("%s%s: %u usages in %u files, %.1f ms", _rename.IsDryRun() ? "" : "Renamed ",
+                                   _rename.GetFrom().CString(), _rename.GetTotalUsages(), _rename.GetNumFiles(),
+                                   _rename.GetElapsedMs());
+
+        String skipped;
+        for (const auto& path: _rename_skipped)
+        {
+            if (CountOpenDocumentUsages(path) > 0)
+                skipped += (skipped.Empty() ? "" : ", ") + GetFileNameAndExtension(path);
+        }
+        if (!skipped.Empty())
+            _status_message += ". Not renamed in open files: " + skipped;
+    }
+
+    /// Count usages of name being renamed in open layout or style at `path`, as it is in the editor.
+    unsigned CountOpenDocumentUsages(const String& path)
+    {
+        String text;
+        if (path == _current_style_file_path && _style_file.NotNull())
+            text = _style_file->ToString();
+        else if (path == _current_file_path && _ui->GetRoot()->GetNumChildren() > 0)
+        {
+            XMLFile xml(context_);
+            if (SerializeLayout(xml))
+                text = xml.ToString();
+        }
+
+        String output;
+        const auto& from = _rename.GetFrom();
+        if (_rename.GetKind() == RENAME_STYLE)
+            return ProjectRename::RenameStyle(text, output, from, from);
+        return ProjectRename::RenameResource(text, output, from, from);
+    }
+
+    /// Remove plain UIElement wrappers from current layout as a single undo step.
+    void CollapseWrappers()
+    {
+        TraceZone trace_zone(_trace, "CollapseWrappers", "edit");
+        auto root = _ui->GetRoot()->GetChild(0u);
+        _optimizer.CollapseWrappers(root, _undo);
+        if (_selected.NotNull() && _selected->GetParent() == nullptr && _selected != _ui->GetRoot())
+            SelectItem(nullptr);
+        _edit_buffers.ReleaseAll();
+        _status_message = ToString("Collapsed %u wrappers, %u -> %u elements", _optimizer.GetCollapsed().Size(),
+                                   _optimizer.GetElementsBefore(), _optimizer.GetElementsAfter());
+    }
+
+    /// Replace current layout by synthetic layout. Generated layout has no file until it is saved.
+    void GenerateLayout(const LayoutGeneratorSettings& settings)
+    {
+        TraceZone trace_zone(_trace, "GenerateLayout", "edit");
+        SelectItem(nullptr);
+        _undo.CloseSession();
+        _ui->GetRoot()->RemoveAllChildren();
+        HiresTimer timer;
+        _generator.Generate(_ui->GetRoot(), settings, _style_file.NotNull() ? _style_file->GetRoot() : XMLElement());
+        _current_file_path.Clear();
+        UpdateWindowTitle();
+        _edit_buffers.ReleaseAll();
+        _status_message = ToString("Generated %u elements, depth %u, %.1f ms", _generator.GetNumElements(),
+                                   _generator.GetDepth(), timer.GetUSec(false) / 1000.0f);
+    }
+
+    /// List undo history in order changes were made. Rows are clipped, only visible ones are built.
+    void RenderUndoHistory()
+    {
+        ui::SetNextWindowSize({400.f, 400.f}, ImGuiSetCond_Once);
+        if (ui::Begin("Undo History", &_show_undo_history))
+        {
+            ui::Text("States: %u, branches: %u", _undo.GetNumStates(), _undo.GetNumBranches());
+            ui::TextDisabled("States that are not on the current branch are dimmed.");
+            ui::Separator();
+
+            ui::BeginChild("States");
+            ImGuiListClipper clipper(_undo.GetNumStates(), ui::GetTextLineHeightWithSpacing());
+            while (clipper.Step())
+            {
+                for (auto i = clipper.DisplayStart; i < clipper.DisplayEnd; i++)
+                {
+                    const auto& node = _undo.GetNode(i);
+                    auto on_path = _undo.IsOnCurrentPath(i);
+                    if (!on_path)
+                        ui::PushStyleColor(ImGuiCol_Text, ui::GetStyle().Colors[ImGuiCol_TextDisabled]);
+                    const char* label = _frame_arena.Format("%5d  branch %-3u %s##%d", i, node.branch,
+                                                            _undo.GetState(i).GetDescription().CString(), i);
+                    if (ui::Selectable(label, i == _undo.GetCurrent()))
+                    {
+                        _recorder.RecordAction("undo_jump", String::EMPTY, i);
+                        JumpToUndoState(i);
+                    }
+                    if (!on_path)
+                        ui::PopStyleColor();
+                }
+            }
+            ui::EndChild();
+        }
+        ui::End();
+    }
+
+    void RenderGenerator()
+    {
+        ui::SetNextWindowSize({400.f, 400.f}, ImGuiSetCond_Once);
+        if (ui::Begin("Generate Layout", &_show_generator))
+        {
+            auto& settings = _generator_settings;
+            ui::InputInt("Seed", &settings.seed);
+            ui::InputInt("Elements", &settings.elements);
+            ui::InputInt("Max Depth", &settings.max_depth);
+            ui::InputInt("Fan-out", &settings.max_children);
+            ui::InputText("Types", &_generator_types.front(), _generator_types.size() - 1);
+            if (ui::IsItemHovered())
+                ui::SetTooltip("Types with optional weights, for example Button:2,Text:5. Empty uses all types.");
+            ui::SliderFloat("Styled", &settings.styled, 0.f, 1.f);
+            if (ui::IsItemHovered())
+                ui::SetTooltip("Fraction of elements using a style derived from style of their type.");
+            // Minimum and maximum are adjacent members.
+            ui::InputInt2("Text Length", &settings.min_text_length);
+            ui::InputInt2("Font Size", &settings.min_font_size);
+            settings.types = &_generator_types.front();
+
+            if (ui::Button(ICON_FA_RANDOM " Generate"))
+            {
+                _recorder.RecordAction("generate", settings.ToString());
+                GenerateLayout(settings);
+            }
+
+            if (!_generator.GetUnknownTypes().Empty())
+            {
+                ui::Separator();
+                ui::TextDisabled("Ignored types:");
+                for (const auto& type: _generator.GetUnknownTypes())
+                    ui::TextDisabled("%s", type.CString());
+            }
+        }
+        ui::End();
+    }
+
+    /// Start recording input and editor actions to `file_path`. Recording starts by loading current files from disk
+    /// with empty undo history, so replay begins from the same state. Unsaved changes must be saved first.
+    void StartRecording(const String& file_path)
+    {
+        if (_undo.IsModified())
+        {
+            ShowError("Save layout before recording, recording starts from saved files.");
+            return;
+        }
+
+        _recorder.StartRecording(file_path);
+        // Loading changes current paths.
+        auto style_path = _current_style_file_path;
+        auto layout_path = _current_file_path;
+        if (!style_path.Empty())
+        {
+            _recorder.RecordAction("load", style_path);
+            LoadFile(style_path);
+        }
+        if (!layout_path.Empty())
+        {
+            _recorder.RecordAction("load", layout_path);
+            LoadFile(layout_path);
+        }
+        if (_minify_on_save)
+            _recorder.RecordAction("minify_on_save", String::EMPTY, true);
+        _status_message = "Recording " + GetFileNameAndExtension(file_path);
+    }
+
+    void StopRecording()
+    {
+        if (!_recorder.IsRecording())
+            return;
+        if (_recorder.StopRecording())
+            _status_message = "Recording saved";
+        else
+            ShowError("Saving input recording failed.");
+    }
+
+    void RenderUITree(UIElement* element)
+    {
+        auto& name = element->GetName();
+        auto& type = element->GetTypeName();
+        ImGuiTreeNodeFlags flags = ImGuiTreeNodeFlags_OpenOnArrow | ImGuiTreeNodeFlags_OpenOnDoubleClick;
+        bool is_internal = element->IsInternal();
+        if (is_internal && !_show_internal)
+            return;
+        else
+            flags |= ImGuiTreeNodeFlags_DefaultOpen;
+
+        if (element == _selected)
+            flags |= ImGuiTreeNodeFlags_Selected;
+
+        if (ui::TreeNodeEx(element, flags, "%s", name.Length() ? name.CString() : type.CString()))
+        {
+            if (ui::IsItemHovered())
+            {
+                if (_show_internal)
+                    ui::SetTooltip("Type: %s\nInternal: %s", type.CString(), is_internal ? "true" : "false");
+                else
+                    ui::SetTooltip("Type: %s", type.CString());
+            }
+
+            if (ui::IsItemHovered() && ui::IsMouseClicked(0))
+            {
+                _recorder.RecordAction("select", GetElementPath(element, _ui->GetRoot()));
+                SelectItem(element);
+            }
+
+            for (auto child: element->GetChildren())
+                RenderUITree(child);
+            ui::TreePop();
+        }
+    }
+
+    String GetAppliedStyle(UIElement* element = nullptr)
+    {
+        if (element == nullptr)
+            element = _selected;
+
+        if (element == nullptr)
+            return "";
+
+        auto applied_style = _selected->GetAppliedStyle();
+        if (applied_style.Empty())
+            applied_style = _selected->GetTypeName();
+        return applied_style;
+    }
+
+    void RenderAttributes(Serializable* item)
+    {
+        ui::Columns(2);
+
+        ui::TextUnformatted("Filter");
+        ui::NextColumn();
+        if (ui::Button(ICON_FA_UNDO))
+            _filter.front() = 0;
+        if (ui::IsItemHovered())
+            ui::SetTooltip("Reset filter.");
+        ui::SameLine();
+        ui::PushID("FilterEdit");
+        ui::InputText("", &_filter.front(), _filter.size() - 1);
+        ui::PopID();
+        ui::NextColumn();
+
+        ui::TextUnformatted("Style");
+        ui::NextColumn();
+
+        const auto& applied_style = _selected->GetAppliedStyle();
+        ui::TextUnformatted(applied_style.Empty() ? _selected->GetTypeName().CString() : applied_style.CString());
+
+        ui::NextColumn();
+
+        const char* filter = _frame_arena.ToLower(&_filter.front());
 
         ui::PushID(item);
         const auto& attributes = *item->GetAttributes();
-        for (const AttributeInfo& info: attributes)
+        for (unsigned attribute_index = 0; attribute_index < attributes.Size(); attribute_index++)
         {
+            const AttributeInfo& info = attributes[attribute_index];
             if (info.mode_ & AM_NOEDIT)
                 continue;
 
-            if (_filter.front() && !info.name_.Contains(&_filter.front(), false))
+            if (!ContainsNoCase(info.name_.CString(), filter))
                 continue;
 
-            Variant value, old_value;
-            value = old_value = item->GetAttribute(info.name_);
+            Variant value = item->GetAttribute(info.name_);
 
             bool modified = false;
 
@@ -711,10 +1779,10 @@ public:
             {
                 if (ui::MenuItem("Reset to default"))
                 {
-                    _undo.TrackValue(item, info.name_, value);
-                    item->SetAttribute(info.name_, info.defaultValue_);
-                    item->ApplyAttributes();
-                    _undo.TrackValue(item, info.name_, info.defaultValue_);
+                    _recorder.RecordAction("set_attribute", info.name_, info.defaultValue_);
+                    _recorder.RecordAction("commit_attribute", info.name_, info.defaultValue_);
+                    SetAttributeValue(item, info.name_, info.defaultValue_);
+                    CommitAttributeValue(item, info.name_, info.defaultValue_);
                 }
 
                 if (style_variant != value)
@@ -723,10 +1791,10 @@ public:
                     {
                         if (ui::MenuItem("Reset to style"))
                         {
-                            _undo.TrackValue(item, info.name_, value);
-                            item->SetAttribute(info.name_, style_variant);
-                            item->ApplyAttributes();
-                            _undo.TrackValue(item, info.name_, style_variant);
+                            _recorder.RecordAction("set_attribute", info.name_, style_variant);
+                            _recorder.RecordAction("commit_attribute", info.name_, style_variant);
+                            SetAttributeValue(item, info.name_, style_variant);
+                            CommitAttributeValue(item, info.name_, style_variant);
                         }
                     }
 
@@ -734,12 +1802,8 @@ public:
                     {
                         if (ui::MenuItem("Save to style"))
                         {
-                            if (style_attribute.IsNull())
-                            {
-                                style_attribute = style_xml.CreateChild("attribute");
-                                style_attribute.SetAttribute("name", info.name_);
-                            }
-                            style_attribute.SetVariant(value);
+                            _recorder.RecordAction("style_set", info.name_, value);
+                            SaveAttributeToStyle(info.name_, value);
                         }
                     }
                 }
@@ -747,7 +1811,10 @@ public:
                 if (style_attribute.NotNull())
                 {
                     if (ui::MenuItem("Remove from style"))
-                        style_attribute.GetParent().RemoveChild(style_attribute);
+                    {
+                        _recorder.RecordAction("style_remove", info.name_);
+                        RemoveAttributeFromStyle(info.name_);
+                    }
                 }
 
                 ImGui::EndPopup();
@@ -825,11 +1892,10 @@ public:
                 }
                 case VAR_STRING:
                 {
-                    auto& v = const_cast<String&>(value.GetString());
-                    auto& buffer = GetBuffer(info.name_, value.GetString());
-                    modified |= ui::InputText("", &buffer.front(), buffer.size() - 1);
+                    auto key = EditBuffers::MakeKey(attribute_index);
+                    modified |= _edit_buffers.InputText("", key, value.GetString());
                     if (modified)
-                        value = &buffer.front();
+                        value = _edit_buffers.GetText(key);
                     break;
                 }
 //            case VAR_BUFFER:
@@ -838,7 +1904,7 @@ public:
                     break;
                 case VAR_RESOURCEREF:
                 {
-                    auto ref = value.GetResourceRef();
+                    const auto& ref = value.GetResourceRef();
                     ui::Text("%s", ref.name_.CString());
                     ui::SameLine();
                     if (ui::Button(ICON_FA_FOLDER_OPEN))
@@ -846,13 +1912,12 @@ public:
                         auto cache = GetSubsystem<ResourceCache>();
                         auto file_name = cache->GetResourceFileName(ref.name_);
                         String selected_path = tinyfd_openFileDialog(
-                            ToString("Open %s File", context_->GetTypeName(ref.type_).CString()).CString(),
+                            _frame_arena.Format("Open %s File", context_->GetTypeName(ref.type_).CString()),
                             file_name.Length() ? file_name.CString() : _current_file_path.CString(), 0, 0, 0, 0);
                         SharedPtr<Resource> resource(cache->GetResource(ref.type_, selected_path));
                         if (resource.NotNull())
                         {
-                            ref.name_ = resource->GetName();
-                            value = ref;
+                            value = ResourceRef(ref.type_, resource->GetName());
                             modified = true;
                         }
                     }
@@ -917,12 +1982,12 @@ public:
 
                     // Insert new item.
                     {
-                        auto& buffer = GetBuffer(info.name_, "");
+                        auto key = EditBuffers::MakeKey(attribute_index, index);
                         ui::PushID(index++);
-                        if (ui::InputText("", &buffer.front(), buffer.size() - 1, ImGuiInputTextFlags_EnterReturnsTrue))
+                        if (_edit_buffers.InputText("", key, String::EMPTY, ImGuiInputTextFlags_EnterReturnsTrue))
                         {
-                            v.Push(&buffer.front());
-                            buffer.front() = 0;
+                            v.Push(_edit_buffers.GetText(key));
+                            _edit_buffers.ClearText(key);
                             modified = true;
                         }
                         ui::PopID();
@@ -931,14 +1996,12 @@ public:
                     // List of current items.
                     for (String& sv: v)
                     {
-                        auto buffer_name = ToString("%s-%d", info.name_.CString(), index);
-                        if (_clear_buffers)
-                            RemoveBuffer(buffer_name);
-                        auto& buffer = GetBuffer(buffer_name, sv);
+                        auto key = EditBuffers::MakeKey(attribute_index, index);
                         ui::PushID(index++);
                         if (ui::Button(ICON_FA_TRASH))
                         {
-                            RemoveBuffer(buffer_name);
+                            // Items after removed one shift, their buffers must be refreshed.
+                            _edit_buffers.ReleaseAll();
                             v.Remove(sv);
                             modified = true;
                             ui::PopID();
@@ -946,9 +2009,11 @@ public:
                         }
                         ui::SameLine();
 
-                        modified |= ui::InputText("", &buffer.front(), buffer.size() - 1, ImGuiInputTextFlags_EnterReturnsTrue);
-                        if (modified)
-                            sv = &buffer.front();
+                        if (_edit_buffers.InputText("", key, sv, ImGuiInputTextFlags_EnterReturnsTrue))
+                        {
+                            sv = _edit_buffers.GetText(key);
+                            modified = true;
+                        }
                         ui::PopID();
                     }
 
@@ -990,19 +2055,14 @@ public:
 
             if (modified)
             {
-                if (!_is_editing_value)
-                {
-                    _is_editing_value = true;
-                    _undo.TrackValue(item, info.name_, old_value);
-                }
-                item->SetAttribute(info.name_, value);
-                item->ApplyAttributes();
+                _recorder.RecordAction("set_attribute", info.name_, value);
+                SetAttributeValue(item, info.name_, value);
             }
 
             if (_is_editing_value && !ui::IsAnyItemActive())
             {
-                _undo.TrackValue(item, info.name_, value);
-                _is_editing_value = false;
+                _recorder.RecordAction("commit_attribute", info.name_, value);
+                CommitAttributeValue(item, info.name_, value);
             }
 
             ui::PopID();
@@ -1012,92 +2072,1445 @@ public:
         ui::Columns(1);
     }
 
-    String GetBaseName(const String& full_path)
+    /// Change attribute of `item` while it is being edited. First change of an edit tracks old value.
+    void SetAttributeValue(Serializable* item, const String& name, const Variant& value)
     {
-        auto parts = full_path.Split('/');
-        return parts.At(parts.Size() - 1);
+        if (!_is_editing_value)
+        {
+            _is_editing_value = true;
+            // Item is not modified yet, so it still holds old value.
+            _undo.TrackValue(item, name, item->GetAttribute(name));
+        }
+        item->SetAttribute(name, value);
+        item->ApplyAttributes();
+        _profiler->Count(FrameProfiler::COUNTER_APPLY_ATTRIBUTES);
     }
 
-    void UpdateWindowTitle()
+    /// Save `value` of attribute `name` of selected element to its style. Attribute that comes from a base style is
+    /// modified there.
+    void SaveAttributeToStyle(const String& name, const Variant& value)
     {
-        String window_name = "UrhoUIEditor";
-        if (!_current_file_path.Empty())
-            window_name += " - " + GetBaseName(_current_file_path);
-        if (!_current_style_file_path.Empty())
-            window_name += " - " + GetBaseName(_current_style_file_path);
-        context_->GetGraphics()->SetWindowTitle(window_name);
-    }
+        auto info = FindAttributeInfo(_selected, name);
+        if (info == nullptr || _style_file.Null())
+            return;
 
-    void SelectItem(UIElement* current)
-    {
-        if (_resizing)
+        XMLElement style_xml;
+        XMLElement style_attribute;
+        Variant style_variant;
+        GetStyleData(*info, style_xml, style_attribute, style_variant);
+        if (style_xml.IsNull())
             return;
 
-        _buffers.Clear();
-        _selected = current;
+        auto style = style_attribute.IsNull() ? style_xml : style_attribute.GetParent();
+        HashMap<String, Variant> values;
+        auto old_value = style_attribute.IsNull() ? Variant() : Variant(style_attribute.GetAttribute("value"));
+        values[name] = old_value;
+        _undo.TrackStyleValue(style, values);
+        if (style_attribute.IsNull())
+        {
+            style_attribute = style_xml.CreateChild("attribute");
+            style_attribute.SetAttribute("name", name);
+        }
+        style_attribute.SetVariant(value);
+        values[name] = style_attribute.GetAttribute("value");
+        _undo.TrackStyleValue(style, values);
+        _style_index.InvalidateStyle(style, name, old_value);
     }
 
-    std::array<char, 0x1000>& GetBuffer(const String& name, const String& default_value)
+    /// Remove attribute `name` from style of selected element, or from base style that sets it.
+    void RemoveAttributeFromStyle(const String& name)
     {
-        auto it = _buffers.Find(name);
-        if (it == _buffers.End())
-        {
-            auto& buffer = _buffers[name];
-            strncpy(&buffer[0], default_value.CString(), buffer.size() - 1);
-            return buffer;
-        }
-        else
-            return it->second_;
+        auto info = FindAttributeInfo(_selected, name);
+        if (info == nullptr || _style_file.Null())
+            return;
+
+        XMLElement style_xml;
+        XMLElement style_attribute;
+        Variant style_variant;
+        GetStyleData(*info, style_xml, style_attribute, style_variant);
+        if (style_attribute.IsNull())
+            return;
+
+        auto style = style_attribute.GetParent();
+        HashMap<String, Variant> values;
+        values[name] = style_attribute.GetAttribute("value");
+        _undo.TrackStyleValue(style, values);
+        style.RemoveChild(style_attribute);
+        _style_index.InvalidateStyle(style, name, values[name]);
+        values[name] = Variant();
+        _undo.TrackStyleValue(style, values);
     }
 
-    void RemoveBuffer(const String& name)
+    /// Finish editing attribute of `item`, changes since SetAttributeValue() become one undo step.
+    void CommitAttributeValue(Serializable* item, const String& name, const Variant& value)
     {
-        _buffers.Erase(name);
+        _undo.TrackValue(item, name, value);
+        _is_editing_value = false;
     }
 
-    void GetStyleData(const AttributeInfo& info, XMLElement& style, XMLElement& attribute, Variant& value)
+    void RenderRenderCost()
     {
-        static XPathQuery _xp_attribute("attribute[@name=$name]", "name:String");
-        static XPathQuery _xp_style("/elements/element[@type=$type]", "type:String");
+        ui::SetNextWindowSize({600.f, 400.f}, ImGuiSetCond_Once);
+        if (ui::Begin("Render Cost", &_show_render_cost))
+        {
+            if (ui::Button(ICON_FA_REPEAT " Refresh") || _auto_refresh_render_cost)
+                _render_cost.Analyze(_ui->GetRoot(), _ui->GetCursor());
+            ui::SameLine();
+            ui::Checkbox("Auto refresh", &_auto_refresh_render_cost);
 
-        _xp_attribute.SetVariable("name", info.name_);
-        style = _selected->GetStyleElement();
-        value = Variant();
+            const auto& total = _render_cost.GetTotal();
+            ui::Text("Draw calls: %u, vertices: %u", total.draw_calls, total.vertices);
+            ui::Text("Texture switches: %u, blend mode switches: %u, clipping breaks: %u", total.texture_switches,
+                     total.blend_switches, total.scissor_breaks);
+            ui::TextColored(ToImGui(Color::RED), "Elements that break batching are red. Values are own (subtree).");
+            ui::Separator();
 
-        if (style.NotNull())
-        {
-            attribute = style.SelectSinglePrepared(_xp_attribute);
-            if (attribute.IsNull())
+            ui::Columns(6);
+            for (auto title: {"Element", "Draw calls", "Vertices", "Textures", "Blend", "Clipping"})
             {
-                auto style_name = _selected->GetAppliedStyle();
-                while (!style_name.Empty())
-                {
-                    _xp_style.SetVariable("type", style_name);
-                    style = _style_file->GetRoot().SelectSinglePrepared(_xp_style);
-                    if (style.NotNull())
-                        style_name = style.GetAttribute("Style");
-                    else
-                        return;
-                }
-                attribute = style.SelectSinglePrepared(_xp_attribute);
+                ui::TextUnformatted(title);
+                ui::NextColumn();
             }
+            ui::Separator();
+            RenderRenderCostTree(_ui->GetRoot());
+            ui::Columns(1);
         }
+        ui::End();
 
-        if (!attribute.IsNull())
+        // Outline elements that break batching on the canvas.
+        auto draw_list = ui::GetOverlayDrawList();
+        for (const auto& cost: _render_cost.GetElements())
         {
-            value = attribute.GetVariantValue(info.enumNames_ ? VAR_STRING : info.type_);
-            if (info.enumNames_)
-            {
-                for (auto i = 0; info.enumNames_[i]; i++)
-                {
-                    if (value.GetString() == info.enumNames_[i])
-                    {
-                        value = i;
-                        break;
-                    }
-                }
+            if (cost.element.Null() || !cost.own.BreaksBatching() || !cost.element->IsVisibleEffective())
+                continue;
+            auto pos = cost.element->GetScreenPosition();
+            auto size = cost.element->GetSize();
+            draw_list->AddRect(ImVec2(pos.x_, pos.y_), ImVec2(pos.x_ + size.x_, pos.y_ + size.y_),
+                               ui::GetColorU32(ToImGui(Color::RED)));
+        }
+    }
+
+    void RenderRenderCostTree(UIElement* element)
+    {
+        auto cost = _render_cost.GetCost(element);
+        if (cost == nullptr || (element->IsInternal() && !_show_internal))
+            return;
+
+        ImGuiTreeNodeFlags flags = ImGuiTreeNodeFlags_OpenOnArrow | ImGuiTreeNodeFlags_DefaultOpen;
+        if (element->GetChildren().Empty())
+            flags |= ImGuiTreeNodeFlags_Leaf;
+        if (element == _selected)
+            flags |= ImGuiTreeNodeFlags_Selected;
+
+        const auto& name = element->GetName();
+        auto breaks_batching = cost->own.BreaksBatching();
+        if (breaks_batching)
+            ui::PushStyleColor(ImGuiCol_Text, ToImGui(Color::RED));
+        auto open = ui::TreeNodeEx(element, flags, "%s", name.Length() ? name.CString() : element->GetTypeName().CString());
+        if (breaks_batching)
+            ui::PopStyleColor();
+        if (ui::IsItemHovered() && ui::IsMouseClicked(0))
+        {
+            _recorder.RecordAction("select", GetElementPath(element, _ui->GetRoot()));
+            SelectItem(element);
+        }
+        ui::NextColumn();
+
+        ui::Text("%u (%u)", cost->own.draw_calls, cost->subtree.draw_calls);
+        ui::NextColumn();
+        ui::Text("%u (%u)", cost->own.vertices, cost->subtree.vertices);
+        ui::NextColumn();
+        ui::Text("%u (%u)", cost->own.texture_switches, cost->subtree.texture_switches);
+        ui::NextColumn();
+        ui::Text("%u (%u)", cost->own.blend_switches, cost->subtree.blend_switches);
+        ui::NextColumn();
+        ui::Text("%u (%u)", cost->own.scissor_breaks, cost->subtree.scissor_breaks);
+        ui::NextColumn();
+
+        if (open)
+        {
+            for (const auto& child: element->GetChildren())
+                RenderRenderCostTree(child);
+            ui::TreePop();
+        }
+    }
+
+    void RenderOverdraw()
+    {
+        // Layout may change every frame, rasterizing rects is cheap enough to keep heatmap live.
+        _overdraw.Analyze(_ui->GetRoot());
+
+        static const Color heat_colors[] = {
+            Color(0.f, 0.f, 1.f, 0.25f), Color(0.f, 1.f, 0.f, 0.35f), Color(1.f, 1.f, 0.f, 0.45f),
+            Color(1.f, 0.5f, 0.f, 0.55f), Color(1.f, 0.f, 0.f, 0.65f)
+        };
+        const auto num_colors = sizeof(heat_colors) / sizeof(heat_colors[0]);
+
+        auto draw_list = ui::GetOverlayDrawList();
+        const auto& heatmap = _overdraw.GetHeatmap();
+        const auto& origin = _overdraw.GetOrigin();
+        auto heatmap_width = _overdraw.GetHeatmapWidth();
+        auto cell_size = static_cast<float>(OverdrawAnalyzer::CELL_SIZE);
+        for (auto i = 0; i < heatmap.Size(); i++)
+        {
+            if (heatmap[i] == 0)
+                continue;
+            auto color = heat_colors[Min<unsigned>(heatmap[i], num_colors) - 1];
+            ImVec2 min(origin.x_ + (i % heatmap_width) * cell_size, origin.y_ + (i / heatmap_width) * cell_size);
+            draw_list->AddRectFilled(min, ImVec2(min.x + cell_size, min.y + cell_size),
+                                     ui::GetColorU32(ToImGui(color)));
+        }
+
+        ui::SetNextWindowSize({360.f, 0.f}, ImGuiSetCond_Once);
+        if (ui::Begin("Overdraw", &_show_overdraw))
+        {
+            ui::Text("Overdraw factor: %.2f", _overdraw.GetOverdrawFactor());
+            ui::Text("Average depth of covered pixels: %.2f", _overdraw.GetAverageDepth());
+            ui::Text("Deepest pixel: %u", _overdraw.GetMaxCount());
+            for (auto i = 0; i < num_colors; i++)
+            {
+                ui::ColorButton(ToImGui(heat_colors[i]));
+                ui::SameLine();
+                ui::Text(i + 1 < num_colors ? "%d" : "%d+", i + 1);
+                if (i + 1 < num_colors)
+                    ui::SameLine();
+            }
+            ui::Separator();
+            ui::TextUnformatted("Worst regions:");
+            for (const auto& region: _overdraw.GetWorstRegions())
+            {
+                ui::Text("%d,%d %dx%d: avg %.2f, max %u", region.rect.left_ - origin.x_, region.rect.top_ - origin.y_,
+                         region.rect.Width(), region.rect.Height(), region.average, region.max);
+                if (ui::IsItemHovered())
+                {
+                    draw_list->AddRect(ImVec2(region.rect.left_, region.rect.top_),
+                                       ImVec2(region.rect.right_, region.rect.bottom_),
+                                       ui::GetColorU32(ToImGui(Color::WHITE)));
+                }
+            }
+        }
+        ui::End();
+    }
+
+    void RenderOptimizerReport()
+    {
+        ui::SetNextWindowSize({400.f, 300.f}, ImGuiSetCond_Once);
+        if (ui::Begin("Collapsed Wrappers", &_show_optimizer_report))
+        {
+            ui::Text("Elements: %u -> %u", _optimizer.GetElementsBefore(), _optimizer.GetElementsAfter());
+            ui::Separator();
+            for (const auto& collapsed: _optimizer.GetCollapsed())
+                ui::Text("%s: %u children moved to parent", collapsed.path.CString(), collapsed.children);
+        }
+        ui::End();
+    }
+
+    void RenderStyleUsage()
+    {
+        ui::SetNextWindowSize({400.f, 400.f}, ImGuiSetCond_Once);
+        if (ui::Begin("Unused Styles", &_show_style_usage))
+        {
+            ui::Text("Layouts: %u", _style_usage.GetLayouts().Size());
+            ui::Text("Styles: %u, unused: %u", _style_usage.GetStyles().Size(), _style_usage.GetUnused().Size());
+            if (ui::Button(ICON_FA_FLOPPY_O " Save Pruned Style As") && _style_file.NotNull())
+            {
+                const char* filters[] = {"*.xml"};
+                if (auto path = tinyfd_saveFileDialog("Save pruned style file", ".", 1, filters, "XML files"))
+                {
+                    if (!_style_usage.SavePruned(_style_file, path))
+                        ShowError(String("Saving pruned style file failed: ") + path);
+                }
+            }
+            ui::Separator();
+            for (const auto& name: _style_usage.GetUnused())
+                ui::TextUnformatted(name.CString());
+            if (!_style_usage.GetUndefined().Empty())
+            {
+                ui::Separator();
+                ui::TextDisabled("Used, but not defined:");
+                for (const auto& name: _style_usage.GetUndefined())
+                    ui::TextDisabled("%s", name.CString());
+            }
+        }
+        ui::End();
+    }
+
+    void RenderProjectIndex()
+    {
+        ui::SetNextWindowSize({400.f, 400.f}, ImGuiSetCond_Once);
+        if (ui::Begin("Project Index", &_show_project_index))
+        {
+            if (ui::Button(ICON_FA_FOLDER_OPEN))
+            {
+                if (auto path = tinyfd_selectFolderDialog("Select project directory", "."))
+                    UpdateProjectIndex(GetAbsoluteFilePath(path));
+            }
+            ui::SameLine();
+            if (ui::Button(ICON_FA_REFRESH) && !_project_index.GetRoot().Empty())
+                UpdateProjectIndex(_project_index.GetRoot());
+            ui::SameLine();
+            ui::TextUnformatted(_project_index.GetRoot().CString());
+            ui::Text("Files: %u", _project_index.GetEntries().Size());
+
+            const char* query_types[] = {"Element type", "Style", "Resource"};
+            ui::PushItemWidth(120.f);
+            auto changed = ui::Combo("##query_type", &_index_query_type, query_types, 3);
+            ui::PopItemWidth();
+            ui::SameLine();
+            changed |= ui::InputText("##query", &_index_query.front(), _index_query.size() - 1);
+            if (changed)
+                _index_results = _project_index.Query(static_cast<ProjectIndexQuery>(_index_query_type),
+                                                      &_index_query.front());
+
+            ui::Separator();
+            for (const auto& path: _index_results)
+            {
+                if (ui::Selectable(path.CString()))
+                    LoadFile(_project_index.GetRoot() + path);
+            }
+        }
+        ui::End();
+    }
+
+    void RenderRename()
+    {
+        ui::SetNextWindowSize({400.f, 400.f}, ImGuiSetCond_Once);
+        if (ui::Begin("Find Usages / Rename", &_show_rename))
+        {
+            if (_project_index.GetRoot().Empty())
+            {
+                ui::TextDisabled("Open project directory in Tools > Project Index first.");
+                ui::End();
+                return;
+            }
+
+            const char* kinds[] = {"Style", "Resource"};
+            ui::Combo("Kind", &_rename_kind, kinds, 2);
+            ui::InputText("Name", &_rename_from.front(), _rename_from.size() - 1);
+            ui::InputText("New name", &_rename_to.front(), _rename_to.size() - 1);
+
+            if (_rename.IsRunning())
+            {
+                ui::ProgressBar(static_cast<float>(_rename.GetNumDone()) / _rename.GetNumFiles());
+                ui::Text("%u / %u files, %.1f ms", _rename.GetNumDone(), _rename.GetNumFiles(),
+                         _rename.GetElapsedMs());
+            }
+            else
+            {
+                auto kind = static_cast<RenameKind>(_rename_kind);
+                if (ui::Button(ICON_FA_SEARCH " Find Usages"))
+                    StartRename(kind, &_rename_from.front(), String::EMPTY, true);
+                ui::SameLine();
+                if (ui::Button("Dry Run") && _rename_to.front() != 0)
+                    StartRename(kind, &_rename_from.front(), &_rename_to.front(), true);
+                ui::SameLine();
+                if (ui::Button(ICON_FA_EXCHANGE " Rename") && _rename_to.front() != 0)
+                    StartRename(kind, &_rename_from.front(), &_rename_to.front(), false);
+            }
+
+            if (_rename.IsFinished() && _rename.GetNumFiles() > 0)
+            {
+                ui::Separator();
+                ui::Text("%u usages in %u files, %.1f ms", _rename.GetTotalUsages(), _rename.GetNumFiles(),
+                         _rename.GetElapsedMs());
+                for (const auto& result: _rename.GetResults())
+                {
+                    const char* path = result.file_path.CString() + _project_index.GetRoot().Length();
+                    if (!result.success)
+                        ui::TextColored({1.f, 0.3f, 0.3f, 1.f}, "%s: %s", path, result.error.CString());
+                    else if (result.usages > 0 && ui::Selectable(_frame_arena.Format("%s: %u", path, result.usages)))
+                        LoadFile(result.file_path);
+                }
+            }
+        }
+        ui::End();
+    }
+
+    String GetBaseName(const String& full_path)
+    {
+        return GetFileNameAndExtension(full_path);
+    }
+
+    void UpdateWindowTitle()
+    {
+        String window_name = "UrhoUIEditor";
+        if (!_current_file_path.Empty())
+            window_name += " - " + GetBaseName(_current_file_path);
+        if (!_current_style_file_path.Empty())
+            window_name += " - " + GetBaseName(_current_style_file_path);
+        if (auto graphics = context_->GetGraphics())
+            graphics->SetWindowTitle(window_name);
+    }
+
+    void SelectItem(UIElement* current)
+    {
+        if (_resizing)
+            return;
+
+        _edit_buffers.ReleaseAll();
+        _selected = current;
+    }
+
+    void GetStyleData(const AttributeInfo& info, XMLElement& style, XMLElement& attribute, Variant& value)
+    {
+        static XPathQuery _xp_attribute("attribute[@name=$name]", "name:String");
+        static XPathQuery _xp_style("/elements/element[@type=$type]", "type:String");
+        static const String _xp_name_variable("name");
+        static const String _xp_type_variable("type");
+        FrameProfileScope profile_scope(_profiler, FrameProfiler::PHASE_STYLE_DATA);
+
+        _xp_attribute.SetVariable(_xp_name_variable, info.name_);
+        style = _selected->GetStyleElement();
+        value = Variant();
+
+        if (style.NotNull())
+        {
+            attribute = style.SelectSinglePrepared(_xp_attribute);
+            _profiler->Count(FrameProfiler::COUNTER_XPATH_QUERIES);
+            if (attribute.IsNull())
+            {
+                // Walk style inheritance chain without copying style names.
+                const char* style_name = _selected->GetAppliedStyle().CString();
+                while (style_name != nullptr && *style_name)
+                {
+                    _xp_style.SetVariable(_xp_type_variable.CString(), style_name);
+                    style = _style_file->GetRoot().SelectSinglePrepared(_xp_style);
+                    _profiler->Count(FrameProfiler::COUNTER_XPATH_QUERIES);
+                    if (style.NotNull())
+                        style_name = style.GetAttributeCString("Style");
+                    else
+                        return;
+                }
+                attribute = style.SelectSinglePrepared(_xp_attribute);
+                _profiler->Count(FrameProfiler::COUNTER_XPATH_QUERIES);
+            }
+        }
+
+        if (!attribute.IsNull())
+            value = GetAttributeValue(attribute, info);
+    }
+
+    /// Run batch command on every input file and print JSON report. Return process exit code.
+    int RunBatch()
+    {
+        static const char* commands[] = {"analyze", "overdraw", "atlas", "minify", "optimize", "codegen", "styles",
+                                         "index", "usages", "rename", "generate", "budget", "validate", 0};
+        auto known_command = false;
+        for (auto i = 0; commands[i] != 0; i++)
+            known_command |= _batch_command == commands[i];
+        if (!known_command)
+        {
+            ShowError("Unknown batch command: " + _batch_command);
+            return EXIT_FAILURE;
+        }
+
+        _ui->GetRoot()->SetSize(ToInt(GetOption("width", "1920")), ToInt(GetOption("height", "1080")));
+
+        auto style_path = GetOption("style");
+        if (!style_path.Empty() && !LoadFile(GetAbsoluteFilePath(style_path)))
+            return EXIT_FAILURE;
+
+        JSONValue report;
+        report["command"] = _batch_command;
+
+        // Style usage only parses layouts, elements are never created.
+        if (_batch_command == "styles")
+        {
+            auto success = BatchStyleUsage(report);
+            WriteReport(report);
+            return success ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+        if (_batch_command == "usages" || _batch_command == "rename")
+        {
+            auto success = BatchRename(report);
+            WriteReport(report);
+            return success ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+        if (_batch_command == "index")
+        {
+            auto success = BatchIndex(report);
+            WriteReport(report);
+            return success ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+        // Input files are outputs of generator.
+        if (_batch_command == "generate")
+        {
+            auto success = BatchGenerate(report);
+            WriteReport(report);
+            return success ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+
+        ExpandInputFiles();
+        auto jobs = GetOption("jobs") == "true" ? GetNumLogicalCPUs() : ToUInt(GetOption("jobs", "1"));
+        if (jobs > 1 && _input_files.Size() > 1)
+        {
+            if (IsShardableCommand(_batch_command))
+                return RunBatchParallel(jobs);
+            PrintLine("Command " + _batch_command + " needs all files in one process, --jobs is ignored.", true);
+        }
+
+        JSONArray files;
+        auto exit_code = EXIT_SUCCESS;
+        for (const auto& file_path: _input_files)
+        {
+            JSONValue result;
+            result["file"] = file_path;
+            auto loaded = LoadFile(file_path);
+            if (!loaded)
+                result["error"] = "Loading file failed.";
+            auto success = loaded && RunBatchCommand(result);
+            result["success"] = success;
+            if (!success)
+                exit_code = EXIT_FAILURE;
+            files.Push(result);
+        }
+        report["files"] = files;
+
+        if (exit_code == EXIT_SUCCESS && !FinishBatchCommand(report))
+            exit_code = EXIT_FAILURE;
+
+        WriteReport(report);
+        return exit_code;
+    }
+
+    /// Serve newline-delimited JSON requests until input ends or `quit` request arrives. Engine, resource cache,
+    /// loaded style and project index stay warm between requests. Return process exit code.
+    int RunServer()
+    {
+        CommandChannel channel;
+        if (!_serve_socket_path.Empty() && !channel.Listen(_serve_socket_path))
+        {
+            ShowError("Listening on socket failed: " + _serve_socket_path);
+            return EXIT_FAILURE;
+        }
+
+        _ui->GetRoot()->SetSize(ToInt(GetOption("width", "1920")), ToInt(GetOption("height", "1080")));
+        auto style_path = GetOption("style");
+        if (!style_path.Empty() && !LoadFile(GetAbsoluteFilePath(style_path)))
+            return EXIT_FAILURE;
+
+        String line;
+        auto quit = false;
+        while (!quit && channel.ReadLine(line))
+        {
+            if (line.Trimmed().Empty())
+                continue;
+
+            JSONValue response;
+            HiresTimer timer;
+            JSONFile request(context_);
+            MemoryBuffer buffer(line.CString(), line.Length());
+            if (!request.Load(buffer) || !request.GetRoot().IsObject())
+            {
+                response["success"] = false;
+                response["error"] = "Request is not a JSON object.";
+            }
+            else
+            {
+                response["id"] = request.GetRoot()["id"];
+                response["success"] = HandleRequest(request.GetRoot(), response, quit);
+            }
+            response["time_ms"] = timer.GetUSec(false) / 1000.0f;
+
+            JSONFile json(context_);
+            json.GetRoot() = response;
+            VectorBuffer output;
+            json.Save(output, " ");
+            // Line breaks inside strings are escaped, remaining ones only format the document.
+            String text(reinterpret_cast<const char*>(output.GetData()), output.GetSize());
+            channel.WriteLine(text.Replaced("\n", ""));
+        }
+        return EXIT_SUCCESS;
+    }
+
+    /// Handle single server request. `command` is any batch command, `export` (alias of `codegen`), `load` (alias
+    /// `validate`), `ping` or `quit`. `file` or `files` give input, `style` switches style file and `options`
+    /// override command line options for this request.
+    bool HandleRequest(const JSONValue& request, JSONValue& response, bool& quit)
+    {
+        auto command = request["command"].GetString();
+        if (command == "quit")
+        {
+            quit = true;
+            return true;
+        }
+        if (command == "ping")
+            return true;
+        if (command == "export")
+            command = "codegen";
+
+        auto style_path = request["style"].GetString();
+        if (!style_path.Empty())
+        {
+            style_path = GetAbsoluteFilePath(style_path);
+            if (style_path != _current_style_file_path && !LoadFile(style_path))
+            {
+                response["error"] = "Loading style failed.";
+                return false;
+            }
+        }
+
+        Vector<String> input_files;
+        if (!request["file"].GetString().Empty())
+            input_files.Push(GetAbsoluteFilePath(request["file"].GetString()));
+        for (const auto& file: request["files"].GetArray())
+            input_files.Push(GetAbsoluteFilePath(file.GetString()));
+
+        // Request options apply to this request only.
+        auto saved_options = _options;
+        for (const auto& it: request["options"].GetObject())
+        {
+            if (it.second_.IsBool())
+                _options[it.first_] = it.second_.GetBool() ? "true" : String::EMPTY;
+            else if (it.second_.IsNumber())
+                _options[it.first_] = String(it.second_.GetDouble());
+            else
+                _options[it.first_] = it.second_.GetString();
+        }
+        // Boolean options set to false are removed.
+        for (auto it = _options.Begin(); it != _options.End();)
+            it = it->second_.Empty() ? _options.Erase(it) : ++it;
+
+        auto success = HandleCommand(command, input_files, response);
+        _options = saved_options;
+        return success;
+    }
+
+    bool HandleCommand(const String& command, const Vector<String>& input_files, JSONValue& response)
+    {
+        _batch_command = command;
+        if (command == "styles" || command == "index" || command == "usages" || command == "rename" ||
+            command == "generate")
+        {
+            _input_files = input_files;
+            if (command == "styles")
+                return BatchStyleUsage(response);
+            if (command == "index")
+                return BatchIndex(response);
+            if (command == "generate")
+                return BatchGenerate(response);
+            return BatchRename(response);
+        }
+
+        if (input_files.Size() != 1)
+        {
+            response["error"] = "Command requires a single file.";
+            return false;
+        }
+
+        const auto& file_path = input_files[0];
+        response["file"] = file_path;
+        if (!LoadFile(file_path))
+        {
+            response["error"] = "Loading file failed.";
+            return false;
+        }
+
+        if (command == "load")
+            return BatchValidate(response);
+        if (IsShardableCommand(command))
+            return RunBatchCommand(response);
+
+        response["error"] = "Unknown command: " + command;
+        return false;
+    }
+
+    /// Return true if batch command processes every file independently, so files can be split between processes.
+    static bool IsShardableCommand(const String& command)
+    {
+        static const char* commands[] = {"analyze", "overdraw", "minify", "optimize", "codegen", "budget", "validate",
+                                         0};
+        for (auto i = 0; commands[i] != 0; i++)
+        {
+            if (command == commands[i])
+                return true;
+        }
+        return false;
+    }
+
+    /// Add files listed in `--file-list` to input files and replace input directories by layouts they contain.
+    void ExpandInputFiles()
+    {
+        auto list_path = GetOption("file-list");
+        if (!list_path.Empty())
+        {
+            File list(context_, GetAbsoluteFilePath(list_path));
+            while (!list.IsEof())
+            {
+                auto line = list.ReadLine().Trimmed();
+                if (!line.Empty())
+                    _input_files.Push(line);
+            }
+        }
+
+        auto fs = GetSubsystem<FileSystem>();
+        Vector<String> files;
+        for (const auto& path: _input_files)
+        {
+            if (!fs->DirExists(path))
+            {
+                files.Push(path);
+                continue;
+            }
+
+            Vector<String> found;
+            fs->ScanDir(found, path, "*.xml", SCAN_FILES, true);
+            Sort(found.Begin(), found.End());
+            for (const auto& name: found)
+            {
+                auto file_path = AddTrailingSlash(path) + name;
+                if (!IsStyleFile(file_path))
+                    files.Push(file_path);
+            }
+        }
+        _input_files = files;
+    }
+
+    /// Return true if XML file is a style sheet, only beginning of the file is read.
+    bool IsStyleFile(const String& file_path)
+    {
+        File file(context_, file_path);
+        char buffer[1024];
+        auto size = file.IsOpen() ? file.Read(buffer, sizeof(buffer)) : 0;
+        return String(buffer, size).Contains("<elements");
+    }
+
+    /// Return directory for temporary files, with trailing slash.
+    static String GetTemporaryDir()
+    {
+#if defined(_WIN32)
+        const char* dir = getenv("TEMP");
+#else
+        const char* dir = getenv("TMPDIR");
+        if (dir == nullptr)
+            dir = "/tmp";
+#endif
+        return dir != nullptr ? AddTrailingSlash(GetInternalPath(dir)) : String::EMPTY;
+    }
+
+    /// Split input files into `jobs` contiguous shards, run batch command on each shard in a separate editor process
+    /// and merge their reports. Workers print their reports to stdout which is read through a pipe.
+    int RunBatchParallel(unsigned jobs)
+    {
+        HiresTimer timer;
+        auto fs = GetSubsystem<FileSystem>();
+        jobs = Min(jobs, _input_files.Size());
+#if defined(_WIN32)
+        auto program = fs->GetProgramDir() + "UIEditor.exe";
+#else
+        auto program = fs->GetProgramDir() + "UIEditor";
+#endif
+
+        Vector<String> arguments;
+        arguments.Push("--batch=" + _batch_command);
+        for (const auto& it: _options)
+        {
+            if (it.first_ != "jobs" && it.first_ != "output" && it.first_ != "file-list")
+                arguments.Push("--" + it.first_ + "=" + it.second_);
+        }
+
+        std::vector<std::unique_ptr<WorkerProcess>> workers;
+        Vector<String> list_paths;
+        unsigned first = 0;
+        auto exit_code = EXIT_SUCCESS;
+        for (unsigned i = 0; i < jobs; i++)
+        {
+            auto count = (_input_files.Size() - first) / (jobs - i);
+            auto list_path = GetTemporaryDir() + ToString("uieditor-%u-%u.txt", Time::GetSystemTime(), i);
+            {
+                File list(context_, list_path, FILE_WRITE);
+                for (unsigned j = first; j < first + count; j++)
+                    list.WriteLine(_input_files[j]);
+            }
+            first += count;
+            list_paths.Push(list_path);
+
+            auto worker_arguments = arguments;
+            worker_arguments.Push("--file-list=" + list_path);
+            workers.emplace_back(new WorkerProcess());
+            if (!workers.back()->Start(program, worker_arguments))
+            {
+                ShowError("Starting worker process failed: " + program);
+                exit_code = EXIT_FAILURE;
+            }
+        }
+
+        JSONValue report;
+        report["command"] = _batch_command;
+        report["jobs"] = jobs;
+        JSONArray files;
+        for (unsigned i = 0; i < workers.size(); i++)
+        {
+            auto output = workers[i]->ReadOutput();
+            if (!workers[i]->Wait())
+                exit_code = EXIT_FAILURE;
+
+            JSONFile json(context_);
+            MemoryBuffer buffer(output.CString(), output.Length());
+            if (output.Empty() || !json.Load(buffer))
+            {
+                ShowError(ToString("Worker %u did not produce a report.", i));
+                exit_code = EXIT_FAILURE;
+                continue;
+            }
+
+            const auto& worker_files = json.GetRoot()["files"].GetArray();
+            for (const auto& file: worker_files)
+                files.Push(file);
+            PrintLine(ToString("Worker %u/%u finished %u files.", i + 1, jobs, worker_files.Size()), true);
+        }
+        for (const auto& list_path: list_paths)
+            fs->Delete(list_path);
+
+        report["files"] = files;
+        report["time_ms"] = timer.GetUSec(false) / 1000.0f;
+        WriteReport(report);
+        return exit_code;
+    }
+
+    /// Run batch command on currently loaded layout and store results in `result`.
+    bool RunBatchCommand(JSONValue& result)
+    {
+        if (_batch_command == "analyze")
+            return BatchAnalyze(result);
+        if (_batch_command == "overdraw")
+            return BatchOverdraw(result);
+        if (_batch_command == "atlas")
+            return BatchCollectAtlas(result);
+        if (_batch_command == "minify")
+            return BatchMinify(result);
+        if (_batch_command == "optimize")
+            return BatchOptimize(result);
+        if (_batch_command == "codegen")
+            return BatchCodegen(result);
+        if (_batch_command == "budget")
+            return BatchBudget(result);
+        if (_batch_command == "validate")
+            return BatchValidate(result);
+        return false;
+    }
+
+    /// Run part of batch command that needs results of all input files.
+    bool FinishBatchCommand(JSONValue& report)
+    {
+        if (_batch_command == "atlas")
+            return BatchApplyAtlas(report);
+        return true;
+    }
+
+    /// Load recording given by `--replay` and replay it headlessly at maximal frame rate. `--style` is loaded first,
+    /// same as in batch mode.
+    bool StartReplay()
+    {
+        if (!_recorder.StartReplay(_replay_path))
+        {
+            ShowError("Opening input recording failed: " + _replay_path);
+            return false;
+        }
+        _style_index.SetRoot(_ui->GetRoot());
+
+        auto style_path = GetOption("style");
+        if (!style_path.Empty() && !LoadFile(GetAbsoluteFilePath(style_path)))
+            return false;
+
+        _replay_frame_times.Clear();
+        engine_->SetMaxFps(0);
+        SubscribeToEvent(E_BEGINFRAME, std::bind(&UIEditorApplication::OnReplayBeginFrame, this));
+        SubscribeToEvent(E_UPDATE, std::bind(&UIEditorApplication::OnUpdate, this, _2));
+        SubscribeToEvent(E_POSTUPDATE, std::bind(&UIEditorApplication::OnReplayPostUpdate, this));
+        SubscribeToEvent(E_ENDFRAME, std::bind(&UIEditorApplication::OnReplayEndFrame, this));
+        return true;
+    }
+
+    void OnReplayBeginFrame()
+    {
+        _replay_frame_timer.Reset();
+        _recorder.BeginFrame();
+    }
+
+    /// Runs at the point of frame where editor renders its windows.
+    void OnReplayPostUpdate()
+    {
+        for (const auto& action: _recorder.GetActions())
+            RunAction(action);
+        _ui->GetRoot()->SetSize(_recorder.GetRootSize());
+        _ui->GetRoot()->SetPosition(_recorder.GetRootPosition());
+        HandleViewportInput();
+        _style_index.ApplyPendingRestyle();
+    }
+
+    void OnReplayEndFrame()
+    {
+        _replay_frame_times.Push(_replay_frame_timer.GetUSec(false) / 1000.0f);
+        if (_recorder.IsReplayFinished())
+        {
+            exitCode_ = FinishReplay();
+            engine_->Exit();
+        }
+    }
+
+    /// Perform recorded editor action. Saving only serializes layout, replay never writes files.
+    void RunAction(const InputAction& action)
+    {
+        if (action.name == "load")
+            LoadFile(action.argument);
+        else if (action.name == "new")
+            _ui->GetRoot()->RemoveAllChildren();
+        else if (action.name == "save_ui")
+        {
+            XMLFile xml(context_);
+            if (_ui->GetRoot()->GetNumChildren() > 0 && SerializeLayout(xml) && _minify_on_save)
+                MinifyLayout(xml, action.argument);
+        }
+        else if (action.name == "minify_on_save")
+            _minify_on_save = action.value.GetBool();
+        else if (action.name == "undo")
+            Undo();
+        else if (action.name == "redo")
+            Redo();
+        else if (action.name == "undo_jump")
+            JumpToUndoState(action.value.GetInt());
+        else if (action.name == "select")
+            SelectItem(FindElementByPath(_ui->GetRoot(), action.argument));
+        else if (action.name == "collapse_wrappers")
+            CollapseWrappers();
+        else if (action.name == "pack_atlas")
+            ReplayTextureAtlas(action.argument, action.value.GetIntVector2());
+        else if (action.name == "generate")
+        {
+            LayoutGeneratorSettings settings;
+            if (settings.FromString(action.argument))
+                GenerateLayout(settings);
+            else
+                PrintLine("Replay: invalid generator settings " + action.argument, true);
+        }
+        else if (_selected.Null())
+            PrintLine("Replay: no selection for action " + action.name, true);
+        else if (action.name == "add_child")
+            AddChildElement(action.argument, action.value.GetString());
+        else if (action.name == "delete")
+            DeleteSelected();
+        else if (action.name == "bring_to_front")
+            _selected->BringToFront();
+        else if (action.name == "set_attribute")
+            SetAttributeValue(_selected, action.argument, action.value);
+        else if (action.name == "commit_attribute")
+            CommitAttributeValue(_selected, action.argument, action.value);
+        else if (action.name == "style_set")
+            SaveAttributeToStyle(action.argument, action.value);
+        else if (action.name == "style_remove")
+            RemoveAttributeFromStyle(action.argument);
+        else
+            PrintLine("Replay: unknown action " + action.name, true);
+    }
+
+    /// Write report with frame timings and hash of final layout. `--frame-times` adds time of every frame,
+    /// `--expect-hash` fails replay when final layout differs. Return process exit code.
+    int FinishReplay()
+    {
+        String layout;
+        XMLFile xml(context_);
+        if (_ui->GetRoot()->GetNumChildren() > 0 && SerializeLayout(xml))
+            layout = xml.ToString();
+        auto layout_hash = StringHash(layout).ToString();
+
+        PODVector<float> sorted = _replay_frame_times;
+        Sort(sorted.Begin(), sorted.End());
+        float total_ms = 0;
+        for (auto ms: sorted)
+            total_ms += ms;
+
+        JSONValue report;
+        report["command"] = "replay";
+        report["file"] = _replay_path;
+        report["frames"] = sorted.Size();
+        report["total_ms"] = total_ms;
+        if (!sorted.Empty())
+        {
+            report["average_ms"] = total_ms / sorted.Size();
+            report["median_ms"] = sorted[sorted.Size() / 2];
+            report["p95_ms"] = sorted[sorted.Size() * 95 / 100];
+            report["max_ms"] = sorted.Back();
+        }
+        report["layout_hash"] = layout_hash;
+
+        if (!GetOption("frame-times").Empty())
+        {
+            JSONArray frame_times;
+            for (auto ms: _replay_frame_times)
+                frame_times.Push(JSONValue(ms));
+            report["frame_times"] = frame_times;
+        }
+
+        auto exit_code = EXIT_SUCCESS;
+        auto expected_hash = GetOption("expect-hash");
+        if (!expected_hash.Empty() && expected_hash.Compare(layout_hash, false) != 0)
+        {
+            report["error"] = "Layout hash " + layout_hash + " does not match expected " + expected_hash;
+            exit_code = EXIT_FAILURE;
+        }
+        report["success"] = exit_code == EXIT_SUCCESS;
+
+        if (!WriteReport(report))
+            exit_code = EXIT_FAILURE;
+        return exit_code;
+    }
+
+    /// Print report to stdout or write it to file given by `--output` option.
+    bool WriteReport(const JSONValue& report)
+    {
+        JSONFile json(context_);
+        json.GetRoot() = report;
+
+        auto output_path = GetOption("output");
+        if (output_path.Empty())
+        {
+            VectorBuffer buffer;
+            json.Save(buffer, "  ");
+            PrintLine(String(reinterpret_cast<const char*>(buffer.GetData()), buffer.GetSize()));
+            return true;
+        }
+
+        File file(context_, output_path, FILE_WRITE);
+        if (!file.IsOpen() || !json.Save(file, "  "))
+        {
+            ShowError("Writing report failed: " + output_path);
+            return false;
+        }
+        return true;
+    }
+
+    static JSONValue ToJSON(const RenderCost& cost)
+    {
+        JSONValue value;
+        value["draw_calls"] = cost.draw_calls;
+        value["vertices"] = cost.vertices;
+        value["texture_switches"] = cost.texture_switches;
+        value["blend_switches"] = cost.blend_switches;
+        value["scissor_breaks"] = cost.scissor_breaks;
+        return value;
+    }
+
+    bool BatchAnalyze(JSONValue& result)
+    {
+        auto root = _ui->GetRoot();
+        _render_cost.Analyze(root);
+        result["total"] = ToJSON(_render_cost.GetTotal());
+
+        JSONArray elements;
+        for (const auto& cost: _render_cost.GetElements())
+        {
+            if (cost.element == root)
+                continue;
+
+            JSONValue element;
+            element["path"] = GetElementPath(cost.element, root);
+            element["type"] = cost.element->GetTypeName();
+            element["depth"] = cost.depth;
+            element["own"] = ToJSON(cost.own);
+            element["subtree"] = ToJSON(cost.subtree);
+            element["breaks_batching"] = cost.own.BreaksBatching();
+            elements.Push(element);
+        }
+        result["elements"] = elements;
+        return true;
+    }
+
+    /// Report overdraw of current layout. Fails when overdraw factor exceeds `--max-overdraw` option.
+    bool BatchOverdraw(JSONValue& result)
+    {
+        _overdraw.Analyze(_ui->GetRoot());
+        result["overdraw_factor"] = _overdraw.GetOverdrawFactor();
+        result["average_depth"] = _overdraw.GetAverageDepth();
+        result["max_depth"] = _overdraw.GetMaxCount();
+        result["covered_pixels"] = _overdraw.GetCoveredPixels();
+
+        const auto& origin = _overdraw.GetOrigin();
+        JSONArray regions;
+        for (const auto& region: _overdraw.GetWorstRegions())
+        {
+            JSONValue value;
+            value["x"] = region.rect.left_ - origin.x_;
+            value["y"] = region.rect.top_ - origin.y_;
+            value["width"] = region.rect.Width();
+            value["height"] = region.rect.Height();
+            value["average"] = region.average;
+            value["max"] = region.max;
+            regions.Push(value);
+        }
+        result["worst_regions"] = regions;
+
+        auto max_overdraw = GetOption("max-overdraw");
+        if (!max_overdraw.Empty() && _overdraw.GetOverdrawFactor() > ToFloat(max_overdraw))
+        {
+            result["error"] = "Overdraw factor exceeds " + max_overdraw;
+            return false;
+        }
+        return true;
+    }
+
+    /// Report number of elements of loaded layout. Layouts that fail to load fail the file.
+    bool BatchValidate(JSONValue& result)
+    {
+        result["elements"] = LayoutOptimizer::CountElements(_ui->GetRoot()->GetChild(0u));
+        return true;
+    }
+
+    /// Check layout against its budget. Layouts without budget file pass, exceeded limits fail the file.
+    bool BatchBudget(JSONValue& result)
+    {
+        const auto file_path = result["file"].GetString();
+        unsigned file_size = 0;
+        {
+            File file(context_, file_path);
+            file_size = file.GetSize();
+        }
+        auto metrics = MeasureLayout(file_size);
+
+        JSONValue measured;
+        measured["elements"] = metrics.elements;
+        measured["depth"] = metrics.depth;
+        measured["draw_calls"] = metrics.draw_calls;
+        measured["textures"] = metrics.textures;
+        measured["overdraw"] = metrics.overdraw;
+        measured["file_size"] = metrics.file_size;
+        result["metrics"] = measured;
+
+        LayoutBudget budget;
+        if (!LoadBudget(file_path, budget))
+        {
+            if (budget.GetError().Empty())
+                return true;
+            result["error"] = budget.GetError();
+            return false;
+        }
+        result["budget"] = budget.GetFilePath();
+
+        auto violations = budget.Check(metrics);
+        result["violations"] = LayoutBudget::ToJSON(violations);
+        if (!violations.Empty())
+        {
+            result["error"] = "Over budget: " + LayoutBudget::ToString(violations);
+            return false;
+        }
+        return true;
+    }
+
+    /// Collect images referenced by layout. Atlas is packed once all layouts are collected.
+    bool BatchCollectAtlas(JSONValue& result)
+    {
+        if (GetOption("atlas").Empty())
+        {
+            result["error"] = "Atlas file path must be given with --atlas option.";
+            return false;
+        }
+
+        _render_cost.Analyze(_ui->GetRoot());
+        result["draw_calls_before"] = _render_cost.GetTotal().draw_calls;
+        _atlas_packer.CollectElements(_ui->GetRoot());
+        return true;
+    }
+
+    /// Pack images of all layouts and style into one atlas, then rewrite layouts and style in place.
+    bool BatchApplyAtlas(JSONValue& report)
+    {
+        _atlas_packer.CollectStyle(_style_file);
+        if (!SaveTextureAtlas(GetAbsoluteFilePath(GetOption("atlas"))))
+            return false;
+
+        JSONValue atlas;
+        atlas["textures"] = _atlas_packer.GetNumTextures();
+        atlas["packed_textures"] = _atlas_packer.GetNumPackedTextures();
+        JSONArray pages;
+        for (unsigned i = 0; i < _atlas_packer.GetPages().Size(); i++)
+        {
+            JSONValue page;
+            page["name"] = _atlas_packer.GetPageNames()[i];
+            page["width"] = _atlas_packer.GetPages()[i]->GetWidth();
+            page["height"] = _atlas_packer.GetPages()[i]->GetHeight();
+            pages.Push(page);
+        }
+        atlas["pages"] = pages;
+        report["atlas"] = atlas;
+
+        // Styles are remapped once, layouts are loaded with remapped style and only their own images are remapped.
+        ApplyTextureAtlas(false, true);
+        auto success = true;
+        auto& files = report["files"];
+        for (unsigned i = 0; i < files.Size(); i++)
+        {
+            auto& result = files[i];
+            auto file_path = result["file"].GetString();
+            if (!LoadFile(file_path))
+            {
+                result["success"] = success = false;
+                continue;
+            }
+
+            ApplyTextureAtlas(true, false);
+            _render_cost.Analyze(_ui->GetRoot());
+            result["draw_calls_after"] = _render_cost.GetTotal().draw_calls;
+            if (!BatchSaveLayout(file_path, result))
+                result["success"] = success = false;
+        }
+
+        if (_style_file.NotNull())
+            success &= SaveFileStyle(_current_style_file_path);
+        return success;
+    }
+
+    /// Minify layout and write it back unless `--dry-run` option is given.
+    bool BatchMinify(JSONValue& result)
+    {
+        XMLFile xml(context_);
+        if (!SerializeLayout(xml))
+        {
+            result["error"] = "Serializing layout failed.";
+            return false;
+        }
+
+        auto file_path = result["file"].GetString();
+        MinifyLayout(xml, file_path);
+        result["removed_attributes"] = _minifier.GetRemovedAttributes();
+        result["bytes_before"] = _minifier.GetBytesBefore();
+        result["bytes_after"] = _minifier.GetBytesAfter();
+
+        if (GetOption("dry-run").Empty())
+        {
+            File file(context_, file_path, FILE_WRITE);
+            if (!file.IsOpen() || !xml.Save(file))
+            {
+                result["error"] = "Writing layout failed.";
+                return false;
             }
         }
+        return true;
+    }
+
+    /// Collapse redundant wrappers and save layout unless `--dry-run` option is given.
+    bool BatchOptimize(JSONValue& result)
+    {
+        CollapseWrappers();
+        result["elements_before"] = _optimizer.GetElementsBefore();
+        result["elements_after"] = _optimizer.GetElementsAfter();
+
+        JSONArray collapsed;
+        for (const auto& wrapper: _optimizer.GetCollapsed())
+        {
+            JSONValue value;
+            value["path"] = wrapper.path;
+            value["children"] = wrapper.children;
+            collapsed.Push(value);
+        }
+        result["collapsed"] = collapsed;
+
+        if (GetOption("dry-run").Empty() && !_optimizer.GetCollapsed().Empty())
+            return BatchSaveLayout(result["file"].GetString(), result);
+        return true;
+    }
+
+    /// Generate synthetic layout into every input file. `--seed` is incremented for every following file, other options
+    /// are those of LayoutGeneratorSettings.
+    bool BatchGenerate(JSONValue& report)
+    {
+        LayoutGeneratorSettings settings;
+        for (auto name = LayoutGeneratorSettings::GetOptionNames(); *name != 0; name++)
+        {
+            auto value = GetOption(*name);
+            if (!value.Empty() && !settings.SetOption(*name, value))
+            {
+                ShowError(ToString("Invalid value of --%s: %s", *name, value.CString()));
+                return false;
+            }
+        }
+        if (_input_files.Empty())
+        {
+            ShowError("Generate requires output layout files.");
+            return false;
+        }
+
+        auto success = true;
+        auto seed = settings.seed;
+        JSONArray files;
+        for (unsigned i = 0; i < _input_files.Size(); i++)
+        {
+            settings.seed = seed + i;
+            GenerateLayout(settings);
+
+            JSONValue result;
+            result["file"] = _input_files[i];
+            result["seed"] = settings.seed;
+            result["elements"] = _generator.GetNumElements();
+            result["depth"] = _generator.GetDepth();
+            auto saved = BatchSaveLayout(_input_files[i], result);
+            result["success"] = saved;
+            success &= saved;
+            files.Push(result);
+        }
+        report["files"] = files;
+
+        settings.seed = seed;
+        report["settings"] = settings.ToString();
+        JSONArray ignored;
+        for (const auto& type: _generator.GetUnknownTypes())
+            ignored.Push(type);
+        report["ignored_types"] = ignored;
+        return success;
+    }
+
+    /// Report styles no input layout uses and write pruned style file to `--pruned-style` when given.
+    bool BatchStyleUsage(JSONValue& report)
+    {
+        if (_style_file.Null())
+        {
+            ShowError("Style usage requires --style option.");
+            return false;
+        }
+
+        AnalyzeStyleUsage(_input_files);
+        auto success = true;
+        JSONArray files;
+        for (const auto& layout: _style_usage.GetLayouts())
+        {
+            // Style sheets and other XML files found in scanned directories are skipped.
+            if (layout.loaded && !layout.is_layout)
+                continue;
+
+            JSONValue result;
+            result["file"] = layout.file_path;
+            result["styles"] = layout.styles.Size();
+            result["success"] = layout.loaded;
+            success &= layout.loaded;
+            files.Push(result);
+        }
+        report["files"] = files;
+        report["styles"] = _style_usage.GetStyles().Size();
+
+        JSONArray unused;
+        for (const auto& name: _style_usage.GetUnused())
+            unused.Push(name);
+        report["unused"] = unused;
+        JSONArray undefined;
+        for (const auto& name: _style_usage.GetUndefined())
+            undefined.Push(name);
+        report["undefined"] = undefined;
+
+        auto pruned_path = GetOption("pruned-style");
+        if (!pruned_path.Empty())
+        {
+            pruned_path = GetAbsoluteFilePath(pruned_path);
+            if (!_style_usage.SavePruned(_style_file, pruned_path))
+            {
+                ShowError("Saving pruned style file failed: " + pruned_path);
+                return false;
+            }
+            report["pruned_style"] = pruned_path;
+        }
+        return success;
+    }
+
+    /// Update index of project directory given as the only input and answer `--query-type`, `--query-style` and
+    /// `--query-resource` queries.
+    bool BatchIndex(JSONValue& report)
+    {
+        if (_input_files.Size() != 1 || !GetSubsystem<FileSystem>()->DirExists(_input_files[0]))
+        {
+            ShowError("Index requires a single project directory.");
+            return false;
+        }
+
+        if (!UpdateProjectIndex(_input_files[0]))
+            return false;
+
+        report["root"] = _project_index.GetRoot();
+        report["index"] = GetProjectIndexPath(_input_files[0]);
+        report["files"] = _project_index.GetEntries().Size();
+        report["parsed"] = _project_index.GetNumParsed();
+        report["reused"] = _project_index.GetNumReused();
+        report["removed"] = _project_index.GetNumRemoved();
+        report["failed"] = _project_index.GetNumFailed();
+
+        static const char* query_options[] = {"query-type", "query-style", "query-resource"};
+        for (auto i = 0; i < 3; i++)
+        {
+            auto value = GetOption(query_options[i]);
+            if (value.Empty())
+                continue;
+
+            JSONArray paths;
+            for (const auto& path: _project_index.Query(static_cast<ProjectIndexQuery>(i), value))
+                paths.Push(path);
+            report[query_options[i]] = paths;
+        }
+        return _project_index.GetNumFailed() == 0;
+    }
+
+    /// Find usages of `--name` or rename `--from` to `--to` in project directory given as the only input. `--kind`
+    /// is `style` (default) or `resource`.
+    bool BatchRename(JSONValue& report)
+    {
+        auto find_only = _batch_command == "usages";
+        auto kind = GetOption("kind", "style") == "resource" ? RENAME_RESOURCE : RENAME_STYLE;
+        auto from = GetOption(find_only ? "name" : "from");
+        auto to = find_only ? String::EMPTY : GetOption("to");
+        if (from.Empty() || (!find_only && to.Empty()))
+        {
+            ShowError(find_only ? "Usages require --name option." : "Rename requires --from and --to options.");
+            return false;
+        }
+
+        JSONValue index_report;
+        if (!BatchIndex(index_report))
+            return false;
+
+        _rename.Start(kind, from, to, FindUsageCandidates(kind, from), !GetOption("dry-run").Empty());
+        _rename.Wait();
+
+        auto success = true;
+        JSONArray files;
+        for (const auto& result: _rename.GetResults())
+        {
+            JSONValue value;
+            value["file"] = result.file_path;
+            value["usages"] = result.usages;
+            value["success"] = result.success;
+            if (!result.success)
+                value["error"] = result.error;
+            success &= result.success;
+            files.Push(value);
+        }
+        report["files"] = files;
+        report["usages"] = _rename.GetTotalUsages();
+        report["dry_run"] = _rename.IsDryRun();
+        report["time_ms"] = _rename.GetElapsedMs();
+
+        // Keep index in sync with rewritten files.
+        if (!_rename.IsDryRun())
+            success &= UpdateProjectIndex(_input_files[0]);
+        return success;
+    }
+
+    /// Export layout as C++ header into `--codegen-dir` or next to the layout.
+    bool BatchCodegen(JSONValue& result)
+    {
+        auto file_path = result["file"].GetString();
+        auto output_dir = GetOption("codegen-dir", GetPath(file_path));
+        auto output_path = AddTrailingSlash(GetAbsoluteFilePath(output_dir)) + GetFileName(file_path) + ".h";
+        if (!ExportCode(output_path))
+        {
+            result["error"] = "Writing code failed.";
+            return false;
+        }
+
+        result["output"] = output_path;
+        result["function"] = LayoutCodeGenerator::MakeFunctionName(output_path);
+        result["elements"] = _code_generator.GetNumElements();
+        result["attributes"] = _code_generator.GetNumAttributes();
+        JSONArray skipped;
+        for (const auto& name: _code_generator.GetSkippedAttributes())
+            skipped.Push(name);
+        result["skipped_attributes"] = skipped;
+        return true;
     }
 };
 